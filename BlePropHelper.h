@@ -28,6 +28,8 @@ class BlePropHelper
 
     void setup(BlePropService propServices [], int propServiceCount)
     {
+      // Allow a larger MTU so multi-entry commands fit in a single write.
+      Bluefruit.configPrphBandwidth(BANDWIDTH_MAX);
       Bluefruit.begin();
 
       // We'll control the LED so we can save some power.
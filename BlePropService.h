@@ -3,15 +3,28 @@
 #include <bluefruit.h>
 #include "BlePropHelper.h"
 
+// Length of the original [pattern][reserved] command write.
+#define PROP_CHARACTERISTIC_FIXED_LEN 2
+
 class BlePropService
 {
   public:
-    BlePropService(int propServiceUuid, int propCharacteristicUuid, char * userDescription, BLECharacteristic::write_cb_t characteristicWriteCallback)
+    BlePropService(int propServiceUuid, int propCharacteristicUuid, char * userDescription, BLECharacteristic::write_cb_t characteristicWriteCallback,
+                   uint16_t characteristicMaxLen = PROP_CHARACTERISTIC_FIXED_LEN)
     {
       mPropService = BLEService(propServiceUuid);
       mPropCharacteristic = BLECharacteristic(propCharacteristicUuid);
       mPropCharacteristicUserDescription = userDescription;
       mCharacteristicWriteCallback = characteristicWriteCallback;
+      mPropCharacteristicMaxLen = characteristicMaxLen;
+    }
+
+    // Adds a read/notify only characteristic for status reports to the service.
+    void addStatusCharacteristic(int statusCharacteristicUuid, const char * userDescription, uint16_t len)
+    {
+      mStatusCharacteristic = BLECharacteristic(statusCharacteristicUuid);
+      mStatusCharacteristicUserDescription = userDescription;
+      mStatusCharacteristicLen = len;
     }
 
     ~BlePropService() {}
@@ -26,6 +39,24 @@ class BlePropService
       return mPropCharacteristic;
     }
 
+    BLECharacteristic & getStatusCharacteristic()
+    {
+      return mStatusCharacteristic;
+    }
+
+    // Notifies subscribed centrals, otherwise only updates the value for reads.
+    void publishStatus(const uint8_t * data, uint16_t len)
+    {
+      if (mStatusCharacteristic.notifyEnabled())
+      {
+        mStatusCharacteristic.notify(data, len);
+      }
+      else
+      {
+        mStatusCharacteristic.write(data, len);
+      }
+    }
+
   private:
     friend class BlePropHelper;
 
@@ -33,6 +64,11 @@ class BlePropService
     BLECharacteristic mPropCharacteristic;
     BLECharacteristic::write_cb_t mCharacteristicWriteCallback = NULL;
     char * mPropCharacteristicUserDescription;
+    uint16_t mPropCharacteristicMaxLen = PROP_CHARACTERISTIC_FIXED_LEN;
+
+    BLECharacteristic mStatusCharacteristic;
+    const char * mStatusCharacteristicUserDescription = NULL;
+    uint16_t mStatusCharacteristicLen = 0;
 
     void setup()
     {
@@ -46,7 +82,15 @@ class BlePropService
       mPropCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE | CHR_PROPS_NOTIFY);
       // Read Permissions, Write Permission
       mPropCharacteristic.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-      mPropCharacteristic.setFixedLen(2);
+      if (mPropCharacteristicMaxLen > PROP_CHARACTERISTIC_FIXED_LEN)
+      {
+        // Variable length so longer commands (e.g. playlists) fit in one write.
+        mPropCharacteristic.setMaxLen(mPropCharacteristicMaxLen);
+      }
+      else
+      {
+        mPropCharacteristic.setFixedLen(PROP_CHARACTERISTIC_FIXED_LEN);
+      }
       mPropCharacteristic.setWriteCallback(mCharacteristicWriteCallback);
       mPropCharacteristic.setUserDescriptor(mPropCharacteristicUserDescription);
       mPropCharacteristic.begin();
@@ -54,6 +98,16 @@ class BlePropService
       uint8_t lsdata[1] = { 0 }; // Set the characteristic to use 8-bit values, with the sensor connected and detected
       mPropCharacteristic.notify(lsdata, 1);     // Use .notify instead of .write!
 
+      if (mStatusCharacteristicLen > 0)
+      {
+        // Read only, the app subscribes for updates.
+        mStatusCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+        mStatusCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+        mStatusCharacteristic.setFixedLen(mStatusCharacteristicLen);
+        mStatusCharacteristic.setUserDescriptor(mStatusCharacteristicUserDescription);
+        mStatusCharacteristic.begin();
+      }
+
     }
 };
 
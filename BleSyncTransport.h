@@ -0,0 +1,61 @@
+#ifndef BLE_SYNC_TRANSPORT_H
+#define BLE_SYNC_TRANSPORT_H
+#include <bluefruit.h>
+#include "SyncTransport.h"
+
+#define BLE_SYNC_QUEUE_SIZE 4
+
+/**
+ * SyncTransport over the prop characteristic. Incoming writes are pushed
+ * from the BLE write callback (timestamped on arrival) and outgoing
+ * messages are sent as notifications.
+ */
+class BleSyncTransport : public SyncTransport
+{
+  public:
+    BleSyncTransport(BLECharacteristic& characteristic): mCharacteristic(characteristic) {}
+
+    ~BleSyncTransport() {}
+
+    // Called from the BLE write callback.
+    void push(const uint8_t * data, uint16_t len, uint32_t receivedAt)
+    {
+      uint8_t next = (mHead + 1) % BLE_SYNC_QUEUE_SIZE;
+      if (next == mTail || len > SYNC_MESSAGE_MAX_LEN)
+      {
+        // Queue full, the next timebase message will replace this one.
+        return;
+      }
+
+      SyncMessage & message = mQueue[mHead];
+      message.receivedAt = receivedAt;
+      message.len = len;
+      memcpy(message.data, data, len);
+      mHead = next;
+    }
+
+    bool send(const uint8_t * data, uint8_t len)
+    {
+      return mCharacteristic.notify(data, len);
+    }
+
+    bool receive(SyncMessage& message)
+    {
+      if (mTail == mHead)
+      {
+        return false;
+      }
+
+      message = mQueue[mTail];
+      mTail = (mTail + 1) % BLE_SYNC_QUEUE_SIZE;
+      return true;
+    }
+
+  private:
+    BLECharacteristic& mCharacteristic;
+    SyncMessage mQueue[BLE_SYNC_QUEUE_SIZE];
+    volatile uint8_t mHead = 0;
+    volatile uint8_t mTail = 0;
+};
+
+#endif
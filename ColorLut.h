@@ -0,0 +1,187 @@
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+/**
+ * Maps the level indices of a recolourable pattern to RGB. The pattern
+ * only stores indices into a PROGMEM table of brightness levels, the
+ * colour comes from a small RAM table rebuilt here whenever the tint,
+ * gradient, palette or hue shift changes, so one animation can be shown
+ * in any colour. A tinted level is color * level / 255, rounded down.
+ */
+class ColorLut
+{
+  public:
+    ColorLut(const uint8_t * levels, uint16_t levelCount)
+    {
+      mLevels = levels;
+      mLevelCount = levelCount;
+      mColors = new uint8_t[levelCount * 3];
+      setTint(0xFFFFFF);
+    }
+
+    ~ColorLut()
+    {
+      delete[] mColors;
+    }
+
+    // Every level is the colour scaled by its brightness.
+    void setTint(uint32_t color)
+    {
+      mMode = LUT_TINT;
+      mBright = color;
+      rebuild();
+    }
+
+    // Level 0 is dark, level 255 bright, in between is interpolated.
+    void setGradient(uint32_t dark, uint32_t bright)
+    {
+      mMode = LUT_GRADIENT;
+      mDark = dark;
+      mBright = bright;
+      rebuild();
+    }
+
+    // One colour per level index, the table has to stay valid.
+    void setPalette(const uint32_t * palette)
+    {
+      mMode = LUT_PALETTE;
+      mPalette = palette;
+      rebuild();
+    }
+
+    // Rotates the hue of every colour, 256 = full turn.
+    void setHueShift(uint8_t hueShift)
+    {
+      mHueShift = hueShift;
+      rebuild();
+    }
+
+    uint16_t getLevelCount()
+    {
+      return mLevelCount;
+    }
+
+    // RGB of a level index.
+    const uint8_t * getColor(uint8_t index)
+    {
+      return mColors + index * 3;
+    }
+
+    // Changes on every rebuild, for caches of rendered frames.
+    uint16_t getRevision()
+    {
+      return mRevision;
+    }
+
+    static uint32_t rotateHue(uint32_t color, uint8_t hueShift)
+    {
+      int16_t red = (color >> 16) & 0xFF;
+      int16_t green = (color >> 8) & 0xFF;
+      int16_t blue = color & 0xFF;
+      int16_t high = red > green ? (red > blue ? red : blue) : (green > blue ? green : blue);
+      int16_t low = red < green ? (red < blue ? red : blue) : (green < blue ? green : blue);
+      int16_t chroma = high - low;
+      if (chroma == 0)
+      {
+        return color;
+      }
+
+      // Hue in 1/256ths of the six 60 degree sectors.
+      int16_t hue;
+      if (high == red)
+      {
+        hue = ((int32_t)(green - blue) * 256) / chroma;
+      }
+      else if (high == green)
+      {
+        hue = 512 + ((int32_t)(blue - red) * 256) / chroma;
+      }
+      else
+      {
+        hue = 1024 + ((int32_t)(red - green) * 256) / chroma;
+      }
+      hue = (hue + hueShift * 6 + 1536) % 1536;
+
+      int16_t fraction = hue & 0xFF;
+      int16_t rising = low + (chroma * fraction) / 256;
+      int16_t falling = high - (chroma * fraction) / 256;
+      switch (hue >> 8)
+      {
+        case 0: red = high; green = rising; blue = low; break;
+        case 1: red = falling; green = high; blue = low; break;
+        case 2: red = low; green = high; blue = rising; break;
+        case 3: red = low; green = falling; blue = high; break;
+        case 4: red = rising; green = low; blue = high; break;
+        default: red = high; green = low; blue = falling; break;
+      }
+      return ((uint32_t)red << 16) | ((uint32_t)green << 8) | blue;
+    }
+
+  private:
+    enum LutMode
+    {
+      LUT_TINT,
+      LUT_GRADIENT,
+      LUT_PALETTE
+    };
+
+    const uint8_t * mLevels;
+    uint16_t mLevelCount;
+    uint8_t * mColors;
+    LutMode mMode = LUT_TINT;
+    uint32_t mDark = 0;
+    uint32_t mBright = 0;
+    const uint32_t * mPalette = NULL;
+    uint8_t mHueShift = 0;
+    volatile uint16_t mRevision = 0;
+
+    void rebuild()
+    {
+      for (uint16_t i = 0; i < mLevelCount; i++)
+      {
+        uint8_t level = pgm_read_byte(&(mLevels[i]));
+        uint32_t color;
+        switch (mMode)
+        {
+          case LUT_GRADIENT:
+            color = mix(mDark, mBright, level);
+            break;
+          case LUT_PALETTE:
+            color = mPalette[i];
+            break;
+          default:
+            color = mix(0, mBright, level);
+            break;
+        }
+
+        if (mHueShift != 0)
+        {
+          color = rotateHue(color, mHueShift);
+        }
+
+        uint8_t * rgb = mColors + i * 3;
+        rgb[0] = color >> 16;
+        rgb[1] = color >> 8;
+        rgb[2] = color;
+      }
+      mRevision++;
+    }
+
+    // from + (to - from) * level / 255 per channel.
+    static uint32_t mix(uint32_t from, uint32_t to, uint8_t level)
+    {
+      uint32_t color = 0;
+      for (uint8_t shift = 0; shift < 24; shift += 8)
+      {
+        int16_t a = (from >> shift) & 0xFF;
+        int16_t b = (to >> shift) & 0xFF;
+        int16_t channel = a + ((int32_t)(b - a) * level) / 255;
+        color |= (uint32_t)channel << shift;
+      }
+      return color;
+    }
+};
+
+#endif
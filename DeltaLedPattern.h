@@ -0,0 +1,182 @@
+#ifndef DELTA_LED_PATTERN_H
+#define DELTA_LED_PATTERN_H
+#include <avr/pgmspace.h>
+#include <Adafruit_NeoPixel.h>
+#include "GimpLedPattern.h"
+
+// Span header: bit 7 set means one colour for the whole span, the low
+// 7 bits are the number of LEDs - 1.
+#define DELTA_SPAN_RUN 0x80
+#define DELTA_SPAN_MAX_LEDS 128
+
+/**
+ * Pattern stored as a byte stream of keyframes and delta frames, as
+ * generated by tools/xcf2pattern -k. Every frame is
+ *   [span count] { [start lo][start hi][span header][r g b]... }
+ * Keyframes cover every LED, delta frames only the LEDs that changed
+ * since the previous frame. Spans are applied in place on the strip
+ * buffer, so playing forward decodes a single delta per frame. Any
+ * other jump restarts from the closest keyframe before it, found
+ * through the keyframe index.
+ * With a ColorLut every colour in the stream is a single level index
+ * instead of [r g b], and the pattern takes the colours of the LUT.
+ */
+class DeltaLedPattern : public GimpLedPattern
+{
+  public:
+    DeltaLedPattern(Adafruit_NeoPixel& strip, const uint8_t * stream, const uint32_t * keyframes,
+                    int totalFrames, int keyframeInterval, int frameDelay, ColorLut * colors = NULL)
+      : GimpLedPattern(strip), mStream(stream), mKeyframes(keyframes), mColors(colors)
+    {
+      mTotalFrames = totalFrames;
+      mKeyframeInterval = keyframeInterval;
+      mFrameDelay = frameDelay;
+    }
+
+    ~DeltaLedPattern() {}
+
+    void playPattern()
+    {
+      for (int framePos = 0; framePos < mTotalFrames; framePos++)
+      {
+        if (mInterrupt)
+        {
+          // If we are interrupted stop the pattern. "Clean" LED pattern.
+          mStrip.clear();
+          mStrip.show();
+          mInterrupt = false;
+          invalidateFrame();
+          return;
+        }
+        renderFrame(framePos);
+        mStrip.show();
+        delay(mFrameDelay);
+      }
+    }
+
+    void stopPattern()
+    {
+      mInterrupt = true;
+    }
+
+    int getTotalFrames()
+    {
+      return mTotalFrames;
+    }
+
+    int getFrameDelay()
+    {
+      return mFrameDelay;
+    }
+
+    void renderFrame(int framePos)
+    {
+      if (mColors != NULL && mColors->getRevision() != mDecodedRevision)
+      {
+        // LEDs kept from the previous frame have the old colours.
+        mDecodedRevision = mColors->getRevision();
+        mDecodedFrame = -1;
+      }
+
+      if (mDecodedFrame < 0 || framePos != mDecodedFrame + 1)
+      {
+        int keyframe = framePos - framePos % mKeyframeInterval;
+        // Carry on from the current frame when it is between the keyframe
+        // and the target, otherwise restart from the keyframe.
+        if (mDecodedFrame < keyframe || mDecodedFrame >= framePos)
+        {
+          mStreamPos = pgm_read_dword(&(mKeyframes[keyframe / mKeyframeInterval]));
+          mDecodedFrame = keyframe - 1;
+        }
+
+        while (mDecodedFrame + 1 < framePos)
+        {
+          decodeFrame();
+        }
+      }
+
+      decodeFrame();
+    }
+
+    void invalidateFrame()
+    {
+      mDecodedFrame = -1;
+    }
+
+    ColorLut * getColorLut()
+    {
+      return mColors;
+    }
+
+  protected:
+    const uint8_t * mStream;
+    const uint32_t * mKeyframes;
+    int mTotalFrames;
+    int mKeyframeInterval;
+    int mFrameDelay;
+    ColorLut * mColors;
+
+    int mDecodedFrame = -1;
+    uint16_t mDecodedRevision = 0;
+    uint32_t mStreamPos = 0;
+
+    void decodeFrame()
+    {
+      uint8_t spanCount = readByte();
+      for (uint8_t span = 0; span < spanCount; span++)
+      {
+        uint16_t ledPos = readByte();
+        ledPos |= readByte() << 8;
+        uint8_t header = readByte();
+        uint8_t ledCount = (header & ~DELTA_SPAN_RUN) + 1;
+
+        if (header & DELTA_SPAN_RUN)
+        {
+          uint8_t rgb[3];
+          readColor(rgb);
+          for (uint8_t i = 0; i < ledCount; i++)
+          {
+            mStrip.setPixelColor(ledPos + i, rgb[0], rgb[1], rgb[2]);
+          }
+        }
+        else
+        {
+          for (uint8_t i = 0; i < ledCount; i++)
+          {
+            uint8_t rgb[3];
+            readColor(rgb);
+            mStrip.setPixelColor(ledPos + i, rgb[0], rgb[1], rgb[2]);
+          }
+        }
+      }
+
+      mDecodedFrame++;
+      if (mDecodedFrame >= mTotalFrames - 1)
+      {
+        // The stream ends here, the next frame is reached through the index.
+        mDecodedFrame = -1;
+      }
+    }
+
+    void readColor(uint8_t * rgb)
+    {
+      if (mColors != NULL)
+      {
+        const uint8_t * color = mColors->getColor(readByte());
+        rgb[0] = color[0];
+        rgb[1] = color[1];
+        rgb[2] = color[2];
+        return;
+      }
+      rgb[0] = readByte();
+      rgb[1] = readByte();
+      rgb[2] = readByte();
+    }
+
+    uint8_t readByte()
+    {
+      return pgm_read_byte(&(mStream[mStreamPos++]));
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+#include <Adafruit_NeoPixel.h>
+#include "GimpLedPattern.h"
+
+// RAM set aside for cached frames. Patterns that don't fit fall back to
+// rendering through setPixelColor().
+#ifndef FRAME_CACHE_MAX_BYTES
+#define FRAME_CACHE_MAX_BYTES 2048
+#endif
+
+/**
+ * Keeps every frame of the active pattern in the strip's native byte
+ * order with the brightness already applied, so showing a frame is a
+ * single memcpy into getPixels(). Rebuilt when the pattern, its colours
+ * or the strip brightness change.
+ */
+class FrameCache
+{
+  public:
+    FrameCache(Adafruit_NeoPixel& strip): mStrip(strip) {}
+
+    ~FrameCache() {}
+
+    // Copies the frame into the strip buffer. Returns false if the
+    // pattern can't be cached, the caller then renders it normally.
+    bool blit(GimpLedPattern * pattern, int framePos)
+    {
+      if (pattern != mPattern || mStrip.getBrightness() != mBrightness || getRevision(pattern) != mRevision)
+      {
+        build(pattern);
+      }
+
+      if (!mValid)
+      {
+        return false;
+      }
+
+      memcpy(mStrip.getPixels(), mFrames + framePos * mFrameBytes, mFrameBytes);
+      return true;
+    }
+
+    void invalidate()
+    {
+      mPattern = NULL;
+      mValid = false;
+    }
+
+  private:
+    Adafruit_NeoPixel& mStrip;
+    GimpLedPattern * mPattern = NULL;
+    uint8_t mBrightness = 0;
+    uint16_t mRevision = 0;
+    bool mValid = false;
+    uint16_t mFrameBytes = 0;
+    uint8_t mFrames[FRAME_CACHE_MAX_BYTES];
+
+    void build(GimpLedPattern * pattern)
+    {
+      mPattern = pattern;
+      mBrightness = mStrip.getBrightness();
+      // Taken first so a recolour during the build triggers another one.
+      mRevision = getRevision(pattern);
+      mFrameBytes = mStrip.numPixels() * 3;
+
+      int totalFrames = pattern->getTotalFrames();
+      mValid = (uint32_t)totalFrames * mFrameBytes <= FRAME_CACHE_MAX_BYTES;
+      if (!mValid)
+      {
+        return;
+      }
+
+      // Let the strip do the reordering and brightness scaling once per
+      // frame and keep the result.
+      uint8_t * pixels = mStrip.getPixels();
+      mStrip.clear();
+      pattern->invalidateFrame();
+      for (int framePos = 0; framePos < totalFrames; framePos++)
+      {
+        pattern->renderFrame(framePos);
+        memcpy(mFrames + framePos * mFrameBytes, pixels, mFrameBytes);
+      }
+    }
+
+    static uint16_t getRevision(GimpLedPattern * pattern)
+    {
+      ColorLut * colors = pattern->getColorLut();
+      return colors != NULL ? colors->getRevision() : 0;
+    }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef FRAME_DEADLINE_MONITOR_H
+#define FRAME_DEADLINE_MONITOR_H
+#include <stdint.h>
+
+// A frame shown later than this after its deadline counts as late.
+#define FRAME_LATE_THRESHOLD_MS 10
+
+struct FrameTimingStats
+{
+  uint32_t framesShown;
+  uint32_t framesDropped; // skipped to stay on time
+  uint32_t framesLate;
+  uint16_t lastOverrunMs;
+  uint16_t maxOverrunMs;
+};
+
+/**
+ * Keeps track of how late frames reach the strip. The player reports
+ * every frame it shows with how far past its deadline it was and how
+ * many frames it skipped to get back on time.
+ */
+class FrameDeadlineMonitor
+{
+  public:
+    FrameDeadlineMonitor()
+    {
+      reset();
+    }
+
+    ~FrameDeadlineMonitor() {}
+
+    void onFrameShown(uint32_t overrunMs, uint32_t skippedFrames)
+    {
+      if (overrunMs > 0xFFFF)
+      {
+        overrunMs = 0xFFFF;
+      }
+
+      mStats.framesShown++;
+      mStats.framesDropped += skippedFrames;
+      mStats.lastOverrunMs = overrunMs;
+      if (overrunMs > mStats.maxOverrunMs)
+      {
+        mStats.maxOverrunMs = overrunMs;
+      }
+      if (overrunMs > FRAME_LATE_THRESHOLD_MS)
+      {
+        mStats.framesLate++;
+      }
+    }
+
+    const FrameTimingStats& getStats()
+    {
+      return mStats;
+    }
+
+    void reset()
+    {
+      mStats.framesShown = 0;
+      mStats.framesDropped = 0;
+      mStats.framesLate = 0;
+      mStats.lastOverrunMs = 0;
+      mStats.maxOverrunMs = 0;
+    }
+
+  private:
+    FrameTimingStats mStats;
+};
+
+#endif
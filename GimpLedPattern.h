@@ -8,7 +8,19 @@
 #ifndef GIMP_LED_PATTERN_H
 #define GIMP_LED_PATTERN_H
 #include <Adafruit_NeoPixel.h>
+#include "ColorLut.h"
 
+// Frame delay reported by patterns that only implement playPattern().
+#define GIMP_LED_PATTERN_DEFAULT_DELAY 100
+
+/**
+ * Extends the base class the Gimp LEDs plug-in writes with frame access
+ * for PatternPlayer. Don't let the plug-in overwrite this file: export
+ * into another directory and copy only the Pattern_*.h over, or use
+ * tools/xcf2pattern. Patterns written by the plug-in still compile, they
+ * only implement playPattern() and play in PatternPlayer as one dark
+ * frame until they are regenerated with tools/xcf2pattern.
+ */
 class GimpLedPattern
 {
   public:
@@ -18,6 +30,21 @@ class GimpLedPattern
     virtual void playPattern() = 0 ;
     virtual void stopPattern() = 0;
 
+    // Frame access used by the non-blocking PatternPlayer.
+    virtual int getTotalFrames() { return 1; }
+    virtual int getFrameDelay() { return GIMP_LED_PATTERN_DEFAULT_DELAY; }
+    // Writes the frame into the strip buffer without calling show().
+    virtual void renderFrame(int framePos)
+    {
+      (void) framePos;
+      mStrip.clear();
+    }
+    // Called when the strip buffer was changed after renderFrame(), patterns
+    // that only update what changed since the last frame must redraw fully.
+    virtual void invalidateFrame() {}
+    // Colours of recolourable patterns, NULL for fixed colour ones.
+    virtual ColorLut * getColorLut() { return NULL; }
+
   protected:
     Adafruit_NeoPixel& mStrip;
     bool mInterrupt = false;
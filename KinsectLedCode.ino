@@ -1,37 +1,77 @@
 #include <Adafruit_NeoPixel.h>
 #include "BlePropHelper.h"
 #include "BlePropService.h"
+#include "PatternPlayer.h"
+#include "PatternSequencer.h"
+#include "PlaybackSync.h"
+#include "BleSyncTransport.h"
+#include "PropStatus.h"
+#include "LedLayout.h"
+#include "SpatialLedPattern.h"
+#include "PropTrace.h"
 #include <bluefruit.h>
 
 // 1 - Include at the top of Arduino sketch under your other #include statements.
-#include "Pattern_ELEMENT_FIRE.h"
-#include "Pattern_ELEMENT_WATER.h"
-#include "Pattern_ELEMENT_THUNDER.h"
-#include "Pattern_ELEMENT_ICE.h"
-#include "Pattern_ELEMENT_DRAGON.h"
+// The elements share one recolourable animation (xcf2pattern -l -n ELEMENT).
+#include "Pattern_ELEMENT.h"
 
 #define LED_PIN    7
 #define LED_COUNT 20
 
 Adafruit_NeoPixel strip(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
 
+// Where each LED sits on the prop: two rows along the body, x runs from
+// head (0) to tail (255). Approximate, measure per installation.
+constexpr LedPoint KINSECT_LAYOUT[LED_COUNT] PROGMEM = {
+  {0, 64}, {28, 56}, {57, 52}, {85, 50}, {113, 48}, {142, 48}, {170, 50}, {198, 52}, {227, 56}, {255, 64},
+  {255, 192}, {227, 200}, {198, 204}, {170, 206}, {142, 208}, {113, 208}, {85, 206}, {57, 204}, {28, 200}, {0, 192}
+};
+LedLayout kinsectLayout(KINSECT_LAYOUT, LED_COUNT);
+
 // 2 - Paste on top of setup() and under Adafruit NeoPixel declaration.
 // Note: This assumes you named your pixel strip 'strip' as in the Adafruit sample
 // from: https://learn.adafruit.com/adafruit-neopixel-uberguide?view=all#arduino-library-installation
 // If you named it differently used that name here instead of 'strip'
-GimpLedPattern * pattern_element_fire = new Pattern_ELEMENT_FIRE(strip);
-GimpLedPattern * pattern_element_water = new Pattern_ELEMENT_WATER(strip);
-GimpLedPattern * pattern_element_thunder = new Pattern_ELEMENT_THUNDER(strip);
-GimpLedPattern * pattern_element_ice = new Pattern_ELEMENT_ICE(strip);
-GimpLedPattern * pattern_element_dragon = new Pattern_ELEMENT_DRAGON(strip);
-
-GimpLedPattern * activePattern = pattern_element_fire;
+GimpLedPattern * pattern_element_fire = new Pattern_ELEMENT(strip, 0xff0000);
+GimpLedPattern * pattern_element_water = new Pattern_ELEMENT(strip, 0x006cfb);
+GimpLedPattern * pattern_element_thunder = new Pattern_ELEMENT(strip, 0xffe600);
+GimpLedPattern * pattern_element_ice = new Pattern_ELEMENT(strip, 0x00cee0);
+GimpLedPattern * pattern_element_dragon = new Pattern_ELEMENT(strip, 0xec13f8);
+GimpLedPattern * pattern_wave_head_to_tail = new SpatialLedPattern(strip, kinsectLayout, SPATIAL_WAVE_X, 0xff0000, 1, 50);
+GimpLedPattern * pattern_radial_pulse = new SpatialLedPattern(strip, kinsectLayout, SPATIAL_RADIAL, 0x00cee0, 1, 50);
+
+// Indexed by the pattern id written over BLE, 0 turns the LEDs off.
+GimpLedPattern * patterns[] = {
+  NULL,
+  pattern_element_fire,
+  pattern_element_water,
+  pattern_element_thunder,
+  pattern_element_ice,
+  pattern_element_dragon,
+  pattern_wave_head_to_tail,
+  pattern_radial_pulse
+};
+const int PATTERN_COUNT = sizeof(patterns) / sizeof(GimpLedPattern*);
+
+GimpLedPattern * getPatternById(uint8_t patternId);
+void playlist_finished_callback(uint8_t tag);
+void activatePattern(GimpLedPattern * pattern);
+void turnOffPattern();
+bool setPatternColor(uint8_t patternId, uint8_t mode, const uint8_t * value, uint16_t len);
+
+PatternPlayer player = PatternPlayer(strip);
+PatternSequencer sequencer = PatternSequencer(player, getPatternById, playlist_finished_callback);
 
 
 #define STATUS_LED (19)
 
 const int LOW_BATTERY_THRESHOLD = 40;
 int lastBatteryReading = 100; 
+int batteryLevel = 100;
+
+// readVBAT() blocks for the ADC to settle, don't do it on every loop().
+const uint32_t BATTERY_READ_INTERVAL_MS = 2000;
+uint32_t lastBatteryReadTime = 0;
 
 const char* DEVICENAME = "Kinsect";
 const char* DEVICE_MODEL = "Kinsect";
@@ -40,7 +80,49 @@ const char* DEVICE_MANUFACTURER = "Rounin Labs";
 
 const int UUID16_SVC_PROP = 0x5300;
 const int UUID16_CHR_PROP_PATTERN = 0x5A38;
-char * SERVICE_DESCRIPTION = "LED Pattern [0-5]";
+char * SERVICE_DESCRIPTION = "LED Pattern [0-7]";
+
+const int UUID16_CHR_PROP_STATUS = 0x5A39;
+const char * STATUS_DESCRIPTION = "Playback Status";
+
+// Commands are written as [command][tag][payload...]. Commands 0-7 select
+// a pattern directly, the tag is echoed back in notifications.
+const uint8_t CMD_PLAYLIST = 0x10;
+// [0x11][tag][rate lo][rate hi][direction], rate is 8.8 fixed point (256 = 1x).
+const uint8_t CMD_PLAYBACK = 0x11;
+const uint16_t CMD_PLAYBACK_LEN = 5;
+// [0x12][tag] clears the frame timing counters in the status.
+const uint8_t CMD_RESET_STATS = 0x12;
+// [0x13][tag][op] controls the command/render trace. A dump is replayed
+// on a PC with tools/propreplay and compared with tools/proptrace.
+const uint8_t CMD_TRACE = 0x13;
+const uint16_t CMD_TRACE_LEN = 3;
+const uint8_t TRACE_OP_STOP = 0;
+const uint8_t TRACE_OP_RECORD = 1;
+const uint8_t TRACE_OP_DUMP = 2;   // prints the trace on Serial
+const uint8_t TRACE_OP_NONE = 0xFF;
+// [0x14][tag][transition][time] sets how pattern switches blend, time in 10ms units.
+const uint8_t CMD_TRANSITION = 0x14;
+const uint16_t CMD_TRANSITION_LEN = 4;
+const uint16_t DEFAULT_TRANSITION_MS = 300;
+// [0x15][tag][pattern id][mode][value...] recolours a recolourable pattern:
+// COLOR_TINT takes [r][g][b], COLOR_HUE_SHIFT [amount] (256 = full turn).
+const uint8_t CMD_COLOR = 0x15;
+const uint16_t CMD_COLOR_LEN = 5;
+const uint8_t COLOR_TINT = 0;
+const uint8_t COLOR_HUE_SHIFT = 1;
+// [0x16][tag][lead] makes this prop the sync leader (1), broadcasting its
+// timebase and start times, or a follower again (0).
+const uint8_t CMD_SYNC_LEAD = 0x16;
+const uint16_t CMD_SYNC_LEAD_LEN = 3;
+// [0x17][tag][pattern id][lead-in] leader only, starts the pattern on
+// every prop at once, lead-in (10ms units, 0 = default) from now so the
+// start time reaches the followers before it is due.
+const uint8_t CMD_SYNC_START = 0x17;
+const uint16_t CMD_SYNC_START_LEN = 4;
+const uint16_t DEFAULT_SYNC_LEAD_IN_MS = 500;
+const uint16_t CMD_HEADER_LEN = 2;
+const uint16_t CMD_MAX_LEN = CMD_HEADER_LEN + SEQUENCER_MAX_ENTRIES * SEQUENCER_ENTRY_SIZE;
 
 void connect_callback(uint16_t conn_handle);
 void disconnect_callback(uint16_t conn_handle, uint8_t reason);
@@ -48,13 +130,49 @@ void characteristic_write_callback(uint16_t conn_hdl, BLECharacteristic* chr, ui
 
 
 // Setup the service.
-BlePropService propPatternService = BlePropService(UUID16_SVC_PROP, UUID16_CHR_PROP_PATTERN, SERVICE_DESCRIPTION,  characteristic_write_callback);
+BlePropService propPatternService = BlePropService(UUID16_SVC_PROP, UUID16_CHR_PROP_PATTERN, SERVICE_DESCRIPTION,  characteristic_write_callback, CMD_MAX_LEN);
 
 // Setup the device information. This will appear when querying the device over BT.
 BlePropHelper propHelper = BlePropHelper(DEVICENAME, DEVICE_MODEL, DEVICE_MANUFACTURER, connect_callback, disconnect_callback); 
 
 BlePropService propServices[] = {propPatternService};
 
+// propHelper sets up the copy in propServices, notify through that one.
+BlePropService & activePropService = propServices[0];
+
+// Shared timebase so several props render the same frame at the same time.
+void sync_start_callback(uint8_t patternId, uint32_t showTime);
+BleSyncTransport syncTransport = BleSyncTransport(activePropService.getPropCharacteristic());
+
+// Playback status, coalesced so it never floods the link.
+void status_send_callback(const uint8_t * data, uint16_t len);
+PropStatusNotifier statusNotifier = PropStatusNotifier(status_send_callback);
+volatile uint8_t lastCommandTag = 0;
+PlaybackSync playbackSync = PlaybackSync(syncTransport, sync_start_callback);
+
+// Recording of what the prop received and rendered.
+void frame_shown_callback(GimpLedPattern * pattern, int framePos);
+PropTrace trace;
+volatile uint8_t pendingTraceOp = TRACE_OP_NONE;
+
+// Recolours are applied from loop(), the player may be rendering with the
+// LUT while the BLE callback runs. One slot per pattern id.
+struct PendingColor
+{
+  volatile bool pending;
+  uint8_t mode;
+  uint8_t value[3];
+};
+PendingColor pendingColors[PATTERN_COUNT];
+
+// Sync role changes and leader starts, applied from loop() around
+// playbackSync.update().
+const uint8_t SYNC_ROLE_NONE = 0xFF;
+volatile uint8_t pendingSyncRole = SYNC_ROLE_NONE;
+volatile bool pendingSyncStart = false;
+uint8_t pendingSyncPatternId = 0;
+uint16_t pendingSyncLeadInMs = 0;
+
 // Power Reduction: https://github.com/adafruit/Adafruit_nRF52_Arduino/issues/165
 // Serial seems to increase consumption by 500uA https://github.com/adafruit/Adafruit_nRF52_Arduino/issues/51#issuecomment-368289198
 #define DEBUG
@@ -77,12 +195,19 @@ void setup() {
   // put your setup code here, to run once:
   // Setup Neopixels
   // Reduce brigthness 0-255
+  activePropService.addStatusCharacteristic(UUID16_CHR_PROP_STATUS, STATUS_DESCRIPTION, sizeof(PropStatus));
   int propServiceCount = sizeof(propServices)/sizeof(BlePropService);
   propHelper.setup(propServices, propServiceCount);
   
   strip.setBrightness(255);
   strip.begin();
+  kinsectLayout.begin();
+  player.setFrameShownCallback(frame_shown_callback);
+  player.setTransitionLayout(&kinsectLayout);
+  player.setTransition(TRANSITION_CROSSFADE, DEFAULT_TRANSITION_MS);
   strip.show(); // Initialize all pixels to 'off'
+
+  activatePattern(pattern_element_fire);
   
 }
 
@@ -113,79 +238,308 @@ void characteristic_write_callback(uint16_t conn_hdl, BLECharacteristic* chr, ui
 
     DEBUG_PRINTLN("Write Received!");
 
-  if (chr->uuid == propPatternService.getPropCharacteristic().uuid)
+  if (chr->uuid == propPatternService.getPropCharacteristic().uuid && len > 0)
   {
       // Handle Ammo Pattern.
       uint8_t pattern = data[0];
+      uint8_t tag = len > 1 ? data[1] : 0;
+      bool accepted = true;
+
+      if (pattern != CMD_TRACE)
+      {
+        trace.recordWrite(millis(), conn_hdl, chr->uuid._uuid.uuid, data, len);
+      }
       
       if( pattern == 0)
       {
         // Turn off LEDs
+        sequencer.cancel();
         turnOffPattern();
       } 
-      else if (pattern == 1)
+      else if (pattern < PATTERN_COUNT)
       {
-        DEBUG_PRINTLN("Fired!");
-    
-        activatePattern(pattern_element_fire);
+        sequencer.cancel();
+        activatePattern(patterns[pattern]);
       }
-      else if (pattern == 2)
+      else if (pattern == SYNC_CMD_TIME || pattern == SYNC_CMD_START_AT)
       {
-        activatePattern(pattern_element_water);
+        // Timestamp on arrival, handled from loop().
+        syncTransport.push(data, len, millis());
       }
-      else if (pattern == 3)
+      else if (pattern == CMD_PLAYBACK && len >= CMD_PLAYBACK_LEN)
       {
-        activatePattern(pattern_element_thunder);
+        player.setRate(data[2] | (data[3] << 8));
+        if (data[4] <= PLAYER_PING_PONG)
+        {
+          player.setDirection((PlayerDirection)data[4]);
+        }
       }
-      else if (pattern == 4)
+      else if (pattern == CMD_RESET_STATS)
       {
-        activatePattern(pattern_element_ice);
+        player.getDeadlineMonitor().reset();
       }
-      else if (pattern == 5)
+      else if (pattern == CMD_TRACE && len >= CMD_TRACE_LEN)
       {
-        activatePattern(pattern_element_dragon);
+        // Serial output runs from loop().
+        pendingTraceOp = data[2];
+      }
+      else if (pattern == CMD_TRANSITION && len >= CMD_TRANSITION_LEN && data[2] <= TRANSITION_WIPE)
+      {
+        player.setTransition((TransitionType)data[2], data[3] * SEQUENCER_TIME_UNIT_MS);
+      }
+      else if (pattern == CMD_COLOR && len >= CMD_COLOR_LEN)
+      {
+        accepted = setPatternColor(data[2], data[3], data + 4, len - 4);
+      }
+      else if (pattern == CMD_SYNC_LEAD && len >= CMD_SYNC_LEAD_LEN && data[2] <= 1)
+      {
+        pendingSyncRole = data[2];
+      }
+      else if (pattern == CMD_SYNC_START && len >= CMD_SYNC_START_LEN && data[2] < PATTERN_COUNT &&
+               (pendingSyncRole == SYNC_ROLE_NONE ? playbackSync.isLeader() : pendingSyncRole == 1))
+      {
+        pendingSyncStart = false;
+        pendingSyncPatternId = data[2];
+        pendingSyncLeadInMs = data[3] > 0 ? data[3] * SEQUENCER_TIME_UNIT_MS : DEFAULT_SYNC_LEAD_IN_MS;
+        pendingSyncStart = true;
+      }
+      else if (pattern == CMD_PLAYLIST && len > CMD_HEADER_LEN)
+      {
+        if (!sequencer.load(data + CMD_HEADER_LEN, len - CMD_HEADER_LEN, tag))
+        {
+          DEBUG_PRINTLN("Invalid playlist");
+          accepted = false;
+        }
+      }
+      else
+      {
+        accepted = false;
+      }
+
+      if (accepted)
+      {
+        lastCommandTag = tag;
+      }
+      // Keep the status out of the way while the app is sending commands.
+      // Not for sync traffic: a leader streams its timebase every
+      // SYNC_LEADER_INTERVAL_MS, which would hold the status off for good.
+      if (pattern != SYNC_CMD_TIME && pattern != SYNC_CMD_START_AT)
+      {
+        statusNotifier.holdOff(millis());
       }
   }
 }
 
+GimpLedPattern * getPatternById(uint8_t patternId)
+{
+  if (patternId >= PATTERN_COUNT)
+  {
+    return NULL;
+  }
+  return patterns[patternId];
+}
 
-void turnOffPattern()
+bool setPatternColor(uint8_t patternId, uint8_t mode, const uint8_t * value, uint16_t len)
 {
-  if(activePattern != NULL)
+  GimpLedPattern * pattern = getPatternById(patternId);
+  if (pattern == NULL || pattern->getColorLut() == NULL)
+  {
+    return false;
+  }
+  if (!(mode == COLOR_TINT && len >= 3) && !(mode == COLOR_HUE_SHIFT && len >= 1))
   {
-    activePattern->stopPattern();
+    return false;
   }
 
-  strip.clear();
-  strip.show();
+  // Only staged here, rebuilding the LUT is left to loop().
+  PendingColor & color = pendingColors[patternId];
+  color.pending = false;
+  color.mode = mode;
+  memcpy(color.value, value, mode == COLOR_TINT ? 3 : 1);
+  color.pending = true;
+  return true;
+}
 
-  activePattern = NULL;
-  
+void applyPendingColors()
+{
+  for (int i = 1; i < PATTERN_COUNT; i++)
+  {
+    PendingColor & color = pendingColors[i];
+    if (!color.pending)
+    {
+      continue;
+    }
+    color.pending = false;
+
+    // The player picks up the new colours on its next frame.
+    ColorLut * colors = patterns[i]->getColorLut();
+    if (color.mode == COLOR_TINT)
+    {
+      colors->setTint(((uint32_t)color.value[0] << 16) | ((uint32_t)color.value[1] << 8) | color.value[2]);
+    }
+    else
+    {
+      colors->setHueShift(color.value[0]);
+    }
+  }
 }
 
-void activatePattern(GimpLedPattern * pattern)
+void playlist_finished_callback(uint8_t tag)
+{
+  // Let the app know the playlist it uploaded is done.
+  uint8_t finished[CMD_HEADER_LEN] = { CMD_PLAYLIST, tag };
+  activePropService.getPropCharacteristic().notify(finished, CMD_HEADER_LEN);
+}
+
+uint8_t getPatternId(GimpLedPattern * pattern)
 {
-    if(activePattern != NULL)
+  for (int i = 1; i < PATTERN_COUNT; i++)
+  {
+    if (patterns[i] == pattern)
     {
-      activePattern->stopPattern();
+      return i;
     }
+  }
+  return 0;
+}
 
-    activePattern = pattern;
+void status_send_callback(const uint8_t * data, uint16_t len)
+{
+  activePropService.publishStatus(data, len);
+}
+
+void updateStatus(uint32_t now)
+{
+  PropStatus status;
+  status.patternId = getPatternId(player.getPattern());
+  status.state = player.getState();
+  status.framePos = player.getFramePos() < 0 ? 0xFFFF : player.getFramePos();
+  status.flags = 0;
+  if (sequencer.isRunning())
+  {
+    status.flags |= STATUS_FLAG_PLAYLIST;
+  }
+  if (playbackSync.getClock().isSynced())
+  {
+    status.flags |= STATUS_FLAG_SYNCED;
+  }
+  if (playbackSync.isLeader())
+  {
+    status.flags |= STATUS_FLAG_LEADER;
+  }
+  status.lastTag = lastCommandTag;
+  status.battery = batteryLevel;
+
+  const FrameTimingStats& timing = player.getDeadlineMonitor().getStats();
+  status.framesDropped = timing.framesDropped > 0xFFFF ? 0xFFFF : timing.framesDropped;
+  status.maxOverrunMs = timing.maxOverrunMs;
+
+  statusNotifier.update(now, status);
+}
+
+
+void frame_shown_callback(GimpLedPattern * pattern, int framePos)
+{
+  trace.recordShow(millis(), getPatternId(pattern), framePos);
+}
+
+void handleTraceOp(uint32_t now)
+{
+  uint8_t op = pendingTraceOp;
+  if (op == TRACE_OP_NONE)
+  {
+    return;
+  }
+  pendingTraceOp = TRACE_OP_NONE;
+
+  switch (op)
+  {
+    case TRACE_OP_STOP:
+      trace.stop();
+      break;
+    case TRACE_OP_RECORD:
+      trace.start(now, getPatternId(player.getPattern()));
+      break;
+    case TRACE_OP_DUMP:
+      trace.stop();
+      trace.dump(Serial);
+      break;
+  }
+}
+
+void sync_start_callback(uint8_t patternId, uint32_t showTime)
+{
+  trace.recordActivate(millis(), patternId);
+  sequencer.cancel();
+  player.setLevel(PLAYER_LEVEL_MAX);
+  player.playAt(getPatternById(patternId), showTime);
+}
+
+void turnOffPattern()
+{
+  // The player fades the strip out (or clears it) once it picks this up in loop().
+  trace.recordActivate(millis(), 0);
+  player.stop();
+}
+
+void activatePattern(GimpLedPattern * pattern)
+{
+  trace.recordActivate(millis(), getPatternId(pattern));
+  player.setLevel(PLAYER_LEVEL_MAX);
+  player.play(pattern);
 }
 
 
 
 void loop() {
   
-  // 3 - Paste inside loop() to run the pattern.
-  if(activePattern != NULL)
+  uint32_t now = millis();
+
+  handleTraceOp(now);
+  applyPendingColors();
+
+  uint8_t syncRole = pendingSyncRole;
+  if (syncRole != SYNC_ROLE_NONE)
+  {
+    pendingSyncRole = SYNC_ROLE_NONE;
+    playbackSync.setLeader(syncRole == 1);
+  }
+
+  // Playback runs on the shared show time once a timebase was received.
+  playbackSync.update(now);
+  uint32_t showTime = playbackSync.toShowTime(now);
+  int32_t timebaseStep = playbackSync.getTimebaseStep();
+  if (timebaseStep != 0)
+  {
+    // Keep the current animation going across the jump.
+    player.shiftTime(timebaseStep);
+    sequencer.shiftTime(timebaseStep);
+  }
+
+  if (pendingSyncStart)
+  {
+    pendingSyncStart = false;
+    if (playbackSync.isLeader())
+    {
+      // Sent to the followers and started here, on the leader's clock.
+      playbackSync.startAt(pendingSyncPatternId, showTime + pendingSyncLeadInMs);
+    }
+  }
+
+  // Sequencer first so an entry it starts is picked up by the player right away.
+  sequencer.update(showTime);
+  player.update(showTime);
+
+  updateStatus(now);
+
+  if (now - lastBatteryReadTime < BATTERY_READ_INTERVAL_MS)
   {
-    activePattern->playPattern();
+    return;
   }
-  // 4 - Optional: Use this to stop the pattern while it is in the middle of running.
-  //pattern_ammopattern_watermoss->stopPattern();
+  lastBatteryReadTime = now;
 
   int batt = propHelper.readBatteryLevel();
+  batteryLevel = batt;
 
   // Notify battery level once we are low so we don't constantly notify the app.
   if(batt < LOW_BATTERY_THRESHOLD && batt != lastBatteryReading)
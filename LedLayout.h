@@ -0,0 +1,111 @@
+#ifndef LED_LAYOUT_H
+#define LED_LAYOUT_H
+#include <avr/pgmspace.h>
+#include <math.h>
+
+/**
+ * Physical position of an LED, in layout units (0-255 on both axes).
+ */
+struct LedPoint
+{
+  uint8_t x;
+  uint8_t y;
+};
+
+/**
+ * Maps LED indexes to positions on the prop. The distance from the
+ * centre and the angle around it are computed once in begin(), so
+ * spatial effects only do table lookups per pixel.
+ */
+class LedLayout
+{
+  public:
+    // points is a PROGMEM table with one entry per LED.
+    LedLayout(const LedPoint * points, uint16_t count): mPoints(points), mCount(count) {}
+
+    ~LedLayout()
+    {
+      delete [] mDistance;
+      delete [] mAngle;
+    }
+
+    // Builds the lookup tables around the centroid of the layout.
+    void begin()
+    {
+      uint32_t sumX = 0;
+      uint32_t sumY = 0;
+      for (uint16_t i = 0; i < mCount; i++)
+      {
+        sumX += getX(i);
+        sumY += getY(i);
+      }
+      setCenter(mCount > 0 ? sumX / mCount : 0, mCount > 0 ? sumY / mCount : 0);
+    }
+
+    // Rebuilds the distance and angle tables around (x, y). Distances are
+    // scaled so the LED furthest from the centre is at 255.
+    void setCenter(uint8_t x, uint8_t y)
+    {
+      if (mDistance == NULL)
+      {
+        mDistance = new uint8_t[mCount];
+        mAngle = new uint8_t[mCount];
+      }
+
+      float maxDistance = 0;
+      for (uint16_t i = 0; i < mCount; i++)
+      {
+        float dx = (float)getX(i) - x;
+        float dy = (float)getY(i) - y;
+        float distance = sqrtf(dx * dx + dy * dy);
+        if (distance > maxDistance)
+        {
+          maxDistance = distance;
+        }
+      }
+
+      for (uint16_t i = 0; i < mCount; i++)
+      {
+        float dx = (float)getX(i) - x;
+        float dy = (float)getY(i) - y;
+        float distance = sqrtf(dx * dx + dy * dy);
+        mDistance[i] = maxDistance > 0 ? (uint8_t)(distance * 255 / maxDistance) : 0;
+        // Full turn = 256, starting along +x (64 along +y). Negative
+        // angles wrap around to the top of the range.
+        mAngle[i] = (uint8_t)(int)floorf(atan2f(dy, dx) * 128 / (float)M_PI);
+      }
+    }
+
+    uint16_t getCount()
+    {
+      return mCount;
+    }
+
+    uint8_t getX(uint16_t led)
+    {
+      return pgm_read_byte(&(mPoints[led].x));
+    }
+
+    uint8_t getY(uint16_t led)
+    {
+      return pgm_read_byte(&(mPoints[led].y));
+    }
+
+    uint8_t getDistance(uint16_t led)
+    {
+      return mDistance[led];
+    }
+
+    uint8_t getAngle(uint16_t led)
+    {
+      return mAngle[led];
+    }
+
+  private:
+    const LedPoint * mPoints;
+    uint16_t mCount;
+    uint8_t * mDistance = NULL;
+    uint8_t * mAngle = NULL;
+};
+
+#endif
@@ -0,0 +1,550 @@
+#ifndef PATTERN_PLAYER_H
+#define PATTERN_PLAYER_H
+#include <Adafruit_NeoPixel.h>
+#include "GimpLedPattern.h"
+#include "FrameCache.h"
+#include "FrameDeadlineMonitor.h"
+#include "PatternTransition.h"
+#include "StripOutput.h"
+
+// Full output level, levels are scaled by level / PLAYER_LEVEL_MAX.
+#define PLAYER_LEVEL_MAX 256
+
+// How often the strip is refreshed while a fade is running.
+#define PLAYER_FADE_FRAME_MS 20
+
+// Playback rate in 8.8 fixed point, 256 = normal speed.
+#define PLAYER_RATE_ONE 256
+#define PLAYER_RATE_MIN (PLAYER_RATE_ONE / 4)
+#define PLAYER_RATE_MAX (PLAYER_RATE_ONE * 8)
+
+enum PlayerState
+{
+  PLAYER_STOPPED = 0,
+  PLAYER_PLAYING = 1,
+  PLAYER_WAITING = 2,  // scheduled with playAt(), start time not reached
+  PLAYER_FINISHED = 3  // loop limit reached, holding the last frame
+};
+
+enum PlayerDirection
+{
+  PLAYER_FORWARD = 0,
+  PLAYER_REVERSE = 1,
+  PLAYER_PING_PONG = 2
+};
+
+// Called after every show(), framePos is -1 when the strip was cleared.
+typedef void (*frame_shown_callback_t) (GimpLedPattern * pattern, int framePos);
+
+/**
+ * Non-blocking replacement for calling playPattern() from loop().
+ * Each pattern runs on a playback clock counting elapsed milliseconds
+ * times the rate. The frame shown is picked from the clock position,
+ * so a late update never pushes the rest of the animation back. Rate
+ * and direction changes apply from the next update(), and frames are
+ * skipped when the rate is faster than the loop.
+ * When the loop falls behind (BLE, battery reads, long show() calls) the
+ * frame that should be on the strip now is shown and the ones in between
+ * are dropped, each shown frame's lateness goes to the deadline monitor.
+ * Switching patterns blends from whatever was on the strip using the
+ * transition set with setTransition(), a cut by default.
+ */
+class PatternPlayer
+{
+  public:
+    PatternPlayer(Adafruit_NeoPixel& strip): mStrip(strip), mFrameCache(strip), mTransition(strip), mOutput(strip) {}
+
+    void setFrameShownCallback(frame_shown_callback_t frameShownCallback)
+    {
+      mFrameShown_cb = frameShownCallback;
+    }
+
+    ~PatternPlayer() {}
+
+    // Queues a pattern to start on the next update(). Safe to call from
+    // the BLE callbacks. A NULL pattern turns the strip off.
+    // loops = 0 plays the pattern until something else is queued.
+    void play(GimpLedPattern * pattern, uint16_t loops = 0)
+    {
+      play(pattern, loops, mTransitionType, mTransitionMs);
+    }
+
+    // Like play() with a transition for this switch only.
+    void play(GimpLedPattern * pattern, uint16_t loops, TransitionType transition, uint16_t transitionMs)
+    {
+      mPendingTransition = transition;
+      mPendingTransitionMs = transitionMs;
+      mPendingLoops = loops;
+      mPendingPattern = pattern;
+      mPendingHasStartTime = false;
+      mHasPending = true;
+    }
+
+    // Like play() but frame 0 is shown at startTime and frame N at
+    // startTime + N * frame delay, in the time base passed to update().
+    // A startTime already past starts at the frame due now.
+    void playAt(GimpLedPattern * pattern, uint32_t startTime, uint16_t loops = 0)
+    {
+      playAt(pattern, startTime, loops, mTransitionType, mTransitionMs);
+    }
+
+    // Like playAt() with a transition for this switch only, the
+    // transition starts at startTime too.
+    void playAt(GimpLedPattern * pattern, uint32_t startTime, uint16_t loops, TransitionType transition, uint16_t transitionMs)
+    {
+      mPendingTransition = transition;
+      mPendingTransitionMs = transitionMs;
+      mPendingLoops = loops;
+      mPendingPattern = pattern;
+      mPendingStartTime = startTime;
+      mPendingHasStartTime = true;
+      mHasPending = true;
+    }
+
+    void stop()
+    {
+      play(NULL);
+    }
+
+    // Transition used by play(), playAt() and stop() from now on.
+    void setTransition(TransitionType transition, uint16_t durationMs)
+    {
+      mTransitionType = transition;
+      mTransitionMs = durationMs;
+    }
+
+    void setTransitionLayout(LedLayout * layout)
+    {
+      mTransition.setLayout(layout);
+    }
+
+    bool isTransitioning()
+    {
+      return mTransition.isRunning();
+    }
+
+    // Ramps the output level to 'level' (0 - PLAYER_LEVEL_MAX) over durationMs.
+    void fadeTo(uint16_t level, uint32_t durationMs, uint32_t now)
+    {
+      mFadeFrom = mLevel;
+      mFadeTo = level;
+      mFadeStart = now;
+      mFadeDuration = durationMs;
+      if (durationMs == 0)
+      {
+        mLevel = level;
+      }
+    }
+
+    void setLevel(uint16_t level)
+    {
+      mLevel = level;
+      mFadeTo = level;
+      mFadeDuration = 0;
+    }
+
+    bool isFading()
+    {
+      return mLevel != mFadeTo;
+    }
+
+    // rate is 8.8 fixed point, clamped to 0.25x - 8x.
+    void setRate(uint16_t rate)
+    {
+      if (rate < PLAYER_RATE_MIN)
+      {
+        rate = PLAYER_RATE_MIN;
+      }
+      else if (rate > PLAYER_RATE_MAX)
+      {
+        rate = PLAYER_RATE_MAX;
+      }
+      mRate = rate;
+    }
+
+    uint16_t getRate()
+    {
+      return mRate;
+    }
+
+    void setDirection(PlayerDirection direction)
+    {
+      mDirection = direction;
+    }
+
+    PlayerDirection getDirection()
+    {
+      return mDirection;
+    }
+
+    // Moves the time base passed to update() by step without moving the
+    // animation, for when the show clock itself jumps (locking onto a
+    // sync timebase). Any other gap between updates is played through.
+    void shiftTime(int32_t step)
+    {
+      if (mStarted)
+      {
+        mLastUpdate += step;
+      }
+      mLastShow += step;
+      mFadeStart += step;
+      mFinishTime += step;
+      mTransition.shiftTime(step);
+    }
+
+    // Call from loop() as often as possible.
+    void update(uint32_t now)
+    {
+      if (mHasPending)
+      {
+        mHasPending = false;
+        start(mPendingPattern, mPendingLoops, mPendingHasStartTime ? mPendingStartTime : now);
+      }
+
+      if (mPattern == NULL)
+      {
+        // Keep fading out to black after a stop().
+        if (mTransition.isRunning() && (now - mLastShow) >= PLAYER_FADE_FRAME_MS)
+        {
+          showFrame(-1, now);
+        }
+        return;
+      }
+
+      bool levelChanged = updateLevel(now);
+
+      if (!mStarted)
+      {
+        if ((int32_t)(now - mLastUpdate) < 0)
+        {
+          return;
+        }
+        mStarted = true;
+      }
+
+      if (!mFinished)
+      {
+        advanceClock(now);
+      }
+
+      bool refresh = (levelChanged || mTransition.isRunning()) && (now - mLastShow) >= PLAYER_FADE_FRAME_MS;
+      uint32_t cyclePos = getCyclePos();
+      uint32_t frameIndex = (uint32_t)mLoopCount * getCycleFrames() + cyclePos;
+      if (mFrameIndex < 0 || frameIndex != (uint32_t)mFrameIndex)
+      {
+        int framePos = toFramePos(cyclePos);
+        // The same frame again (a one frame loop, or the last frame held
+        // when the loops run out) is already on the strip.
+        if (mFrameIndex < 0 || framePos != mFramePos || refresh)
+        {
+          if (!showFrame(framePos, now))
+          {
+            // Nothing to show until the transition has started blending.
+            return;
+          }
+        }
+
+        // How long ago this frame was due, and how many were passed over.
+        uint64_t overrunTicks = mClockTicks - cyclePos * getFrameTicks();
+        uint32_t skipped = 0;
+        if (mFrameIndex >= 0 && frameIndex > (uint32_t)mFrameIndex + 1)
+        {
+          skipped = frameIndex - mFrameIndex - 1;
+        }
+        if (!mFinished)
+        {
+          mDeadlineMonitor.onFrameShown(overrunTicks / mRate, skipped);
+        }
+        mFrameIndex = frameIndex;
+      }
+      else if (refresh)
+      {
+        showFrame(mFramePos, now);
+      }
+    }
+
+    GimpLedPattern * getPattern()
+    {
+      return mPattern;
+    }
+
+    int getFramePos()
+    {
+      return mFramePos;
+    }
+
+    uint16_t getLoopCount()
+    {
+      return mLoopCount;
+    }
+
+    StripOutput& getOutput()
+    {
+      return mOutput;
+    }
+
+    FrameDeadlineMonitor& getDeadlineMonitor()
+    {
+      return mDeadlineMonitor;
+    }
+
+    PlayerState getState()
+    {
+      if (mPattern == NULL)
+      {
+        return PLAYER_STOPPED;
+      }
+      if (!mStarted)
+      {
+        return PLAYER_WAITING;
+      }
+      return mFinished ? PLAYER_FINISHED : PLAYER_PLAYING;
+    }
+
+    // True once a pattern started with a loop limit has played all its loops.
+    bool isFinished()
+    {
+      return mFinished;
+    }
+
+    // When the last loop ends, in the time base passed to update(), for
+    // patterns played with a loop limit. Ahead of time this assumes the
+    // rate stays as it is. Once finished it is when the loop really
+    // ended, however late update() noticed.
+    uint32_t getFinishTime()
+    {
+      if (mFinished || mPattern == NULL || mMaxLoops == 0)
+      {
+        return mFinishTime;
+      }
+      uint64_t remaining = (uint64_t)(mMaxLoops - mLoopCount) * getCycleFrames() * getFrameTicks() - mClockTicks;
+      return mLastUpdate + (uint32_t)((remaining + mRate - 1) / mRate);
+    }
+
+    // True while a queued play()/stop() has not been picked up yet.
+    bool hasPending()
+    {
+      return mHasPending;
+    }
+
+  protected:
+    Adafruit_NeoPixel& mStrip;
+    FrameCache mFrameCache;
+    PatternTransition mTransition;
+    StripOutput mOutput;
+    GimpLedPattern * mPattern = NULL;
+    frame_shown_callback_t mFrameShown_cb = NULL;
+
+    volatile bool mHasPending = false;
+    GimpLedPattern * volatile mPendingPattern = NULL;
+    volatile uint16_t mPendingLoops = 0;
+    volatile uint32_t mPendingStartTime = 0;
+    volatile bool mPendingHasStartTime = false;
+    volatile TransitionType mPendingTransition = TRANSITION_CUT;
+    volatile uint16_t mPendingTransitionMs = 0;
+
+    volatile TransitionType mTransitionType = TRANSITION_CUT;
+    volatile uint16_t mTransitionMs = 0;
+
+    FrameDeadlineMonitor mDeadlineMonitor;
+
+    int mFramePos = -1;
+    // Frames played since start, counting skipped ones.
+    int32_t mFrameIndex = -1;
+    bool mStarted = false;
+    uint32_t mLastUpdate = 0;
+    uint32_t mLastShow = 0;
+
+    // Clock position within the current loop, in ms * rate.
+    uint64_t mClockTicks = 0;
+    uint16_t mRate = PLAYER_RATE_ONE;
+    PlayerDirection mDirection = PLAYER_FORWARD;
+
+    uint16_t mLoopCount = 0;
+    uint16_t mMaxLoops = 0;
+    bool mFinished = false;
+    uint32_t mFinishTime = 0;
+
+    uint16_t mLevel = PLAYER_LEVEL_MAX;
+    uint16_t mFadeFrom = PLAYER_LEVEL_MAX;
+    uint16_t mFadeTo = PLAYER_LEVEL_MAX;
+    uint32_t mFadeStart = 0;
+    uint32_t mFadeDuration = 0;
+
+    void start(GimpLedPattern * pattern, uint16_t loops, uint32_t startTime)
+    {
+      mPattern = pattern;
+      mMaxLoops = loops;
+      mLoopCount = 0;
+      mFramePos = -1;
+      mFrameIndex = -1;
+      mFinished = false;
+      mStarted = false;
+      mLastUpdate = startTime;
+      mClockTicks = 0;
+
+      // The strip buffer still holds the last frame shown, the transition
+      // blends from it. Stopping with a cut clears the strip right away.
+      bool blending = mTransition.begin(mPendingTransition, mPendingTransitionMs, startTime);
+      if (mPattern == NULL)
+      {
+        if (!blending)
+        {
+          showFrame(-1, startTime);
+        }
+      }
+      else
+      {
+        mPattern->invalidateFrame();
+      }
+    }
+
+    // Frames in one loop, ping-pong plays the end frames only once.
+    uint32_t getCycleFrames()
+    {
+      int totalFrames = mPattern->getTotalFrames();
+      if (mDirection == PLAYER_PING_PONG && totalFrames > 1)
+      {
+        return 2 * (totalFrames - 1);
+      }
+      return totalFrames;
+    }
+
+    uint64_t getFrameTicks()
+    {
+      return (uint64_t)mPattern->getFrameDelay() * PLAYER_RATE_ONE;
+    }
+
+    void advanceClock(uint32_t now)
+    {
+      int32_t elapsed = (int32_t)(now - mLastUpdate);
+      mLastUpdate = now;
+      if (elapsed > 0)
+      {
+        // However long the loop stalled, so the animation stays in phase.
+        mClockTicks += (uint64_t)elapsed * mRate;
+      }
+
+      uint64_t cycleTicks = getCycleFrames() * getFrameTicks();
+      if (mClockTicks >= cycleTicks)
+      {
+        uint64_t loops = mClockTicks / cycleTicks;
+        mClockTicks -= loops * cycleTicks;
+        if (mMaxLoops != 0 && mLoopCount + loops >= mMaxLoops)
+        {
+          // Hold the last frame of the loop. The loops past the limit and
+          // what is left of the clock were played after the end.
+          uint64_t overshoot = (mLoopCount + loops - mMaxLoops) * cycleTicks + mClockTicks;
+          mFinishTime = now - (uint32_t)(overshoot / mRate);
+          mLoopCount = mMaxLoops;
+          mFinished = true;
+          mClockTicks = cycleTicks - 1;
+        }
+        else
+        {
+          mLoopCount += loops;
+        }
+      }
+    }
+
+    uint32_t getCyclePos()
+    {
+      uint32_t cycleFrames = getCycleFrames();
+      uint32_t cyclePos = mClockTicks / getFrameTicks();
+      if (cyclePos >= cycleFrames)
+      {
+        // Direction changed after the pattern finished.
+        cyclePos = cycleFrames - 1;
+      }
+      return cyclePos;
+    }
+
+    int toFramePos(int cyclePos)
+    {
+      int totalFrames = mPattern->getTotalFrames();
+
+      switch (mDirection)
+      {
+        case PLAYER_REVERSE:
+          return totalFrames - 1 - cyclePos;
+        case PLAYER_PING_PONG:
+          return cyclePos < totalFrames ? cyclePos : 2 * (totalFrames - 1) - cyclePos;
+        default:
+          return cyclePos;
+      }
+    }
+
+    bool updateLevel(uint32_t now)
+    {
+      if (mLevel == mFadeTo)
+      {
+        return false;
+      }
+
+      uint32_t elapsed = now - mFadeStart;
+      if (elapsed >= mFadeDuration)
+      {
+        mLevel = mFadeTo;
+      }
+      else
+      {
+        int32_t delta = (int32_t)mFadeTo - (int32_t)mFadeFrom;
+        mLevel = mFadeFrom + (delta * (int32_t)elapsed) / (int32_t)mFadeDuration;
+      }
+      return true;
+    }
+
+    // Returns false when the show was skipped because the strip would
+    // look the same (a transition at its very start).
+    bool showFrame(int framePos, uint32_t now)
+    {
+      if (mPattern == NULL)
+      {
+        mStrip.clear();
+      }
+      else
+      {
+        if (!mFrameCache.blit(mPattern, framePos))
+        {
+          mPattern->renderFrame(framePos);
+        }
+
+        if (mLevel < PLAYER_LEVEL_MAX || mTransition.isRunning())
+        {
+          // The pattern can't carry on from a modified buffer.
+          mPattern->invalidateFrame();
+        }
+        if (mLevel < PLAYER_LEVEL_MAX)
+        {
+          scalePixels(mLevel);
+        }
+      }
+
+      if (!mTransition.apply(now))
+      {
+        return false;
+      }
+      // Only frames as the pattern rendered them are worth caching.
+      bool asRendered = mPattern != NULL && mLevel >= PLAYER_LEVEL_MAX && !mTransition.isRunning();
+      mOutput.show(asRendered ? mPattern : NULL, framePos);
+      mFramePos = framePos;
+      mLastShow = now;
+      if (mFrameShown_cb != NULL)
+      {
+        mFrameShown_cb(mPattern, framePos);
+      }
+      return true;
+    }
+
+    void scalePixels(uint16_t level)
+    {
+      uint8_t * pixels = mStrip.getPixels();
+      uint16_t numBytes = mStrip.numPixels() * 3;
+      for (uint16_t i = 0; i < numBytes; i++)
+      {
+        pixels[i] = (pixels[i] * level) >> 8;
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef PATTERN_SEQUENCER_H
+#define PATTERN_SEQUENCER_H
+#include "GimpLedPattern.h"
+#include "PatternPlayer.h"
+
+#define SEQUENCER_MAX_ENTRIES 16
+
+// Wire size of one playlist entry:
+// [pattern id][end mode | transition << 4][value lo][value hi][transition time]
+#define SEQUENCER_ENTRY_SIZE 5
+
+// Durations and transition times are sent in 10ms units.
+#define SEQUENCER_TIME_UNIT_MS 10
+
+enum SequencerEndMode
+{
+  SEQ_END_REPEAT = 0,   // value = number of loops
+  SEQ_END_DURATION = 1, // value = duration in SEQUENCER_TIME_UNIT_MS
+  SEQ_END_FOREVER = 2   // plays until the next command
+};
+
+enum SequencerTransition
+{
+  SEQ_TRANSITION_CUT = 0,
+  SEQ_TRANSITION_FADE = 1,      // fade out the previous entry, then fade this one in
+  SEQ_TRANSITION_CROSSFADE = 2, // blend the previous entry into this one
+  SEQ_TRANSITION_WIPE = 3
+};
+
+struct SequencerEntry
+{
+  uint8_t patternId;
+  uint8_t endMode;
+  uint8_t transition;
+  uint16_t value;
+  uint16_t transitionMs;
+};
+
+typedef GimpLedPattern * (*pattern_lookup_t) (uint8_t patternId);
+typedef void (*sequencer_finished_callback_t) (uint8_t tag);
+
+/**
+ * Runs a playlist uploaded in a single BLE write on-device, so a show
+ * doesn't need a round trip to the phone for every pattern change.
+ */
+class PatternSequencer
+{
+  public:
+    PatternSequencer(PatternPlayer& player, pattern_lookup_t patternLookup, sequencer_finished_callback_t finishedCallback)
+      : mPlayer(player)
+    {
+      mPatternLookup = patternLookup;
+      mFinished_cb = finishedCallback;
+    }
+
+    ~PatternSequencer() {}
+
+    // Parses the playlist entries of a write. Only copies into a staging
+    // buffer so it is safe to call from the BLE callbacks, the playlist
+    // starts on the next update(). The tag is handed back once it finishes.
+    bool load(const uint8_t * data, uint16_t len, uint8_t tag)
+    {
+      if (len == 0 || (len % SEQUENCER_ENTRY_SIZE) != 0 || len / SEQUENCER_ENTRY_SIZE > SEQUENCER_MAX_ENTRIES)
+      {
+        return false;
+      }
+
+      mHasStaged = false;
+
+      mStagedCount = len / SEQUENCER_ENTRY_SIZE;
+      for (int i = 0; i < mStagedCount; i++)
+      {
+        const uint8_t * raw = data + i * SEQUENCER_ENTRY_SIZE;
+        SequencerEntry & entry = mStaged[i];
+        entry.patternId = raw[0];
+        entry.endMode = raw[1] & 0x0F;
+        entry.transition = raw[1] >> 4;
+        entry.value = raw[2] | (raw[3] << 8);
+        entry.transitionMs = raw[4] * SEQUENCER_TIME_UNIT_MS;
+      }
+      mStagedTag = tag;
+
+      mCancelRequested = false;
+      mHasStaged = true;
+      return true;
+    }
+
+    // Stops the running playlist without touching the player, used when a
+    // direct pattern command takes over.
+    void cancel()
+    {
+      mHasStaged = false;
+      mCancelRequested = true;
+    }
+
+    bool isRunning()
+    {
+      return mState != SEQ_STATE_IDLE;
+    }
+
+    // See PatternPlayer::shiftTime().
+    void shiftTime(int32_t step)
+    {
+      mEntryStart += step;
+      mFadeEnd += step;
+    }
+
+    // Call from loop() before PatternPlayer::update().
+    void update(uint32_t now)
+    {
+      if (mCancelRequested)
+      {
+        mCancelRequested = false;
+        mState = SEQ_STATE_IDLE;
+      }
+
+      if (mHasStaged)
+      {
+        mHasStaged = false;
+        memcpy(mEntries, mStaged, sizeof(SequencerEntry) * mStagedCount);
+        mEntryCount = mStagedCount;
+        mTag = mStagedTag;
+        mIndex = 0;
+        startEntry(now);
+      }
+
+      // Entries start when the previous one was due to end, not when that
+      // was noticed, so a late loop() doesn't push the rest of the
+      // playlist back.
+      uint32_t end;
+      if (mState == SEQ_STATE_FADING_OUT)
+      {
+        if ((int32_t)(now - mFadeEnd) >= 0)
+        {
+          startEntry(mFadeEnd);
+        }
+      }
+      else if (mState == SEQ_STATE_PLAYING && isEntryDone(now, end))
+      {
+        advance(end);
+      }
+    }
+
+  protected:
+    enum SequencerState
+    {
+      SEQ_STATE_IDLE,
+      SEQ_STATE_FADING_OUT,
+      SEQ_STATE_PLAYING
+    };
+
+    PatternPlayer& mPlayer;
+    pattern_lookup_t mPatternLookup = NULL;
+    sequencer_finished_callback_t mFinished_cb = NULL;
+
+    SequencerEntry mEntries[SEQUENCER_MAX_ENTRIES];
+    uint8_t mEntryCount = 0;
+    uint8_t mIndex = 0;
+    uint8_t mTag = 0;
+    SequencerState mState = SEQ_STATE_IDLE;
+    uint32_t mEntryStart = 0;
+    uint32_t mFadeEnd = 0;
+
+    SequencerEntry mStaged[SEQUENCER_MAX_ENTRIES];
+    uint8_t mStagedCount = 0;
+    uint8_t mStagedTag = 0;
+    volatile bool mHasStaged = false;
+    volatile bool mCancelRequested = false;
+
+    void startEntry(uint32_t startTime)
+    {
+      SequencerEntry & entry = mEntries[mIndex];
+      uint16_t loops = 0;
+      if (entry.endMode == SEQ_END_REPEAT)
+      {
+        loops = entry.value > 0 ? entry.value : 1;
+      }
+
+      TransitionType transition = TRANSITION_CUT;
+      if (entry.transition == SEQ_TRANSITION_CROSSFADE)
+      {
+        transition = TRANSITION_CROSSFADE;
+      }
+      else if (entry.transition == SEQ_TRANSITION_WIPE)
+      {
+        transition = TRANSITION_WIPE;
+      }
+      mPlayer.playAt(mPatternLookup(entry.patternId), startTime, loops, transition, entry.transitionMs);
+
+      if (entry.transition == SEQ_TRANSITION_FADE && entry.transitionMs > 0)
+      {
+        mPlayer.setLevel(0);
+        mPlayer.fadeTo(PLAYER_LEVEL_MAX, entry.transitionMs / 2, startTime);
+      }
+      else
+      {
+        mPlayer.setLevel(PLAYER_LEVEL_MAX);
+      }
+
+      mEntryStart = startTime;
+      mState = SEQ_STATE_PLAYING;
+    }
+
+    // Sets end to when the entry was due to end.
+    bool isEntryDone(uint32_t now, uint32_t& end)
+    {
+      SequencerEntry & entry = mEntries[mIndex];
+      if (mPlayer.hasPending())
+      {
+        return false;
+      }
+
+      switch (entry.endMode)
+      {
+        case SEQ_END_REPEAT:
+          if (mPlayer.getPattern() == NULL)
+          {
+            // Pattern id 0 (off) never finishes a loop, skip over it.
+            end = mEntryStart;
+            return true;
+          }
+          // Due before the player has seen it, so the next entry starts in
+          // the same loop().
+          end = mPlayer.getFinishTime();
+          return (int32_t)(now - end) >= 0;
+        case SEQ_END_DURATION:
+          end = mEntryStart + (uint32_t)entry.value * SEQUENCER_TIME_UNIT_MS;
+          return (int32_t)(now - end) >= 0;
+        default:
+          return false;
+      }
+    }
+
+    void advance(uint32_t end)
+    {
+      mIndex++;
+      if (mIndex >= mEntryCount)
+      {
+        mState = SEQ_STATE_IDLE;
+        mPlayer.playAt(NULL, end);
+        if (mFinished_cb != NULL)
+        {
+          mFinished_cb(mTag);
+        }
+        return;
+      }
+
+      SequencerEntry & next = mEntries[mIndex];
+      if (next.transition == SEQ_TRANSITION_FADE && next.transitionMs > 0)
+      {
+        mPlayer.fadeTo(0, next.transitionMs / 2, end);
+        mFadeEnd = end + next.transitionMs / 2;
+        mState = SEQ_STATE_FADING_OUT;
+      }
+      else
+      {
+        startEntry(end);
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef PATTERN_TRANSITION_H
+#define PATTERN_TRANSITION_H
+#include <Adafruit_NeoPixel.h>
+#include "LedLayout.h"
+
+// RAM kept for the outgoing frame. Strips that don't fit always cut.
+#ifndef TRANSITION_MAX_BYTES
+#define TRANSITION_MAX_BYTES 384
+#endif
+
+// Blend factors are 0 - TRANSITION_ALPHA_MAX (incoming frame only).
+#define TRANSITION_ALPHA_MAX 256
+
+// Width of the soft edge of a wipe, in layout units (0 - 255).
+#define TRANSITION_WIPE_EDGE 32
+
+enum TransitionType
+{
+  TRANSITION_CUT = 0,
+  TRANSITION_CROSSFADE = 1,
+  TRANSITION_WIPE = 2 // left to right along the layout, or strip order
+};
+
+/**
+ * Blends the last frame shown before a pattern switch into the frames of
+ * the incoming pattern. The outgoing frame is kept as raw strip bytes,
+ * which are already in the strip's byte order and brightness, and the
+ * incoming frame is blended over it in place in the strip buffer.
+ */
+class PatternTransition
+{
+  public:
+    PatternTransition(Adafruit_NeoPixel& strip): mStrip(strip) {}
+
+    ~PatternTransition() {}
+
+    // Wipes follow the x axis of the layout when one is set.
+    void setLayout(LedLayout * layout)
+    {
+      mLayout = layout;
+    }
+
+    // Takes the strip buffer as the outgoing frame. Returns false when
+    // there is nothing to blend and the switch should just cut.
+    bool begin(TransitionType type, uint16_t durationMs, uint32_t startTime)
+    {
+      uint16_t numBytes = mStrip.numPixels() * 3;
+      if (type == TRANSITION_CUT || durationMs == 0 || numBytes > TRANSITION_MAX_BYTES)
+      {
+        mRunning = false;
+        return false;
+      }
+
+      memcpy(mFrom, mStrip.getPixels(), numBytes);
+      mType = type;
+      mDuration = durationMs;
+      mStart = startTime;
+      mRunning = true;
+      return true;
+    }
+
+    void cancel()
+    {
+      mRunning = false;
+    }
+
+    bool isRunning()
+    {
+      return mRunning;
+    }
+
+    // See PatternPlayer::shiftTime().
+    void shiftTime(int32_t step)
+    {
+      mStart += step;
+    }
+
+    // Blends the outgoing frame over the incoming one in the strip buffer.
+    // The transition ends with the first call that leaves the incoming
+    // frame untouched. Returns false while the blend is still all
+    // outgoing frame, the strip already shows exactly that.
+    bool apply(uint32_t now)
+    {
+      if (!mRunning)
+      {
+        return true;
+      }
+
+      int32_t elapsed = (int32_t)(now - mStart);
+      if (elapsed >= (int32_t)mDuration)
+      {
+        mRunning = false;
+        return true;
+      }
+      uint16_t progress = elapsed > 0 ? ((uint32_t)elapsed * TRANSITION_ALPHA_MAX) / mDuration : 0;
+      if (progress == 0)
+      {
+        memcpy(mStrip.getPixels(), mFrom, mStrip.numPixels() * 3);
+        return false;
+      }
+
+      if (mType == TRANSITION_WIPE)
+      {
+        // Done once the edge has passed every LED, the rest of the time
+        // would only show the incoming frame again.
+        mRunning = !applyWipe(progress);
+      }
+      else
+      {
+        uint16_t numBytes = mStrip.numPixels() * 3;
+        blend(mStrip.getPixels(), mFrom, numBytes, progress);
+      }
+      return true;
+    }
+
+  private:
+    Adafruit_NeoPixel& mStrip;
+    LedLayout * mLayout = NULL;
+    uint8_t mFrom[TRANSITION_MAX_BYTES];
+    TransitionType mType = TRANSITION_CUT;
+    uint16_t mDuration = 0;
+    uint32_t mStart = 0;
+    bool mRunning = false;
+
+    // Returns true when every LED is past the edge.
+    bool applyWipe(uint16_t progress)
+    {
+      bool covered = true;
+      uint16_t numPixels = mStrip.numPixels();
+      uint8_t * pixels = mStrip.getPixels();
+      // The edge starts fully before the first LED and ends fully past the last.
+      int16_t edge = (int32_t)progress * (256 + TRANSITION_WIPE_EDGE) / TRANSITION_ALPHA_MAX;
+
+      // LEDs past the end of a shorter layout go by their strip index.
+      uint16_t layoutCount = mLayout != NULL ? mLayout->getCount() : 0;
+
+      for (uint16_t i = 0; i < numPixels; i++)
+      {
+        int16_t position = i < layoutCount ? mLayout->getX(i) : ((uint32_t)i * 256) / numPixels;
+        int16_t alpha = (edge - position) * TRANSITION_ALPHA_MAX / TRANSITION_WIPE_EDGE;
+        if (alpha < 0)
+        {
+          alpha = 0;
+        }
+        else if (alpha > TRANSITION_ALPHA_MAX)
+        {
+          alpha = TRANSITION_ALPHA_MAX;
+        }
+        if (alpha < TRANSITION_ALPHA_MAX)
+        {
+          covered = false;
+        }
+        blend(pixels + i * 3, mFrom + i * 3, 3, alpha);
+      }
+      return covered;
+    }
+
+    // to = from + (to - from) * alpha, in place.
+    static void blend(uint8_t * to, const uint8_t * from, uint16_t numBytes, uint16_t alpha)
+    {
+      for (uint16_t i = 0; i < numBytes; i++)
+      {
+        to[i] = from[i] + ((((int32_t)to[i] - from[i]) * alpha) >> 8);
+      }
+    }
+};
+
+#endif
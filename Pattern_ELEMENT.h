@@ -0,0 +1,64 @@
+
+/****
+ * Pattern file generated from GimpFiles/Element_Fire.xcf by tools/xcf2pattern.
+ * Delta encoded, see DeltaLedPattern.h for the stream layout.
+ * Recolourable, colours are indices into ELEMENT_LEVELS, see ColorLut.h.
+ ****/ 
+ 
+#ifndef ELEMENT_H
+#define ELEMENT_H
+#include <avr/pgmspace.h>
+#include <Adafruit_NeoPixel.h>
+#include "DeltaLedPattern.h"
+
+#define ELEMENT_DELAY 200
+
+#define ELEMENT_TOTAL_LEDS 20
+
+#define ELEMENT_TOTAL_FRAMES 8
+
+#define ELEMENT_KEYFRAME_INTERVAL 8
+
+#define ELEMENT_COLOR 0xff0000
+
+#define ELEMENT_LEVEL_COUNT 5
+
+namespace NS_ELEMENT {
+
+	const uint8_t ELEMENT_LEVELS[] PROGMEM = { 38, 63, 127, 191, 255 };
+
+	// 8 frames, 1 keyframes, 40 bytes (640 bytes as frame tables).
+	const uint8_t ELEMENT_STREAM[] PROGMEM = { 
+	0x01, 0x00, 0x00, 0x93, 0x04, 0x01, 0x00, 0x00, 0x93, 0x03, 0x01, 0x00, 0x00, 0x93, 0x02, 0x01, 
+	0x00, 0x00, 0x93, 0x01, 0x01, 0x00, 0x00, 0x93, 0x00, 0x01, 0x00, 0x00, 0x93, 0x01, 0x01, 0x00, 
+	0x00, 0x93, 0x02, 0x01, 0x00, 0x00, 0x93, 0x03
+
+		};
+
+	const uint32_t ELEMENT_KEYFRAMES[] PROGMEM = { 
+	0,
+	};
+
+}
+
+using namespace NS_ELEMENT;
+
+		
+class Pattern_ELEMENT : public DeltaLedPattern 
+{
+
+  public:
+    Pattern_ELEMENT(Adafruit_NeoPixel& strip, uint32_t color = ELEMENT_COLOR)
+      : DeltaLedPattern(strip, ELEMENT_STREAM, ELEMENT_KEYFRAMES, ELEMENT_TOTAL_FRAMES, ELEMENT_KEYFRAME_INTERVAL, ELEMENT_DELAY, &mLevelColors),
+        mLevelColors(ELEMENT_LEVELS, ELEMENT_LEVEL_COUNT)
+    {
+      mLevelColors.setTint(color);
+    }
+
+    ~Pattern_ELEMENT(){}
+
+  protected:
+    ColorLut mLevelColors;
+};
+		
+#endif //ELEMENT_H
@@ -1,90 +1,36 @@
 
 /****
- * Pattern file Generated from a Gimp Image file using the Gimp LEDs plug-in.
- * Gimp LEDs Plug-in Download: https://bit.ly/GimpLeds
- * Gimp Download: https://www.gimp.org
+ * Pattern file generated from GimpFiles/Element_Dragon.xcf by tools/xcf2pattern.
+ * Delta encoded, see DeltaLedPattern.h for the stream layout.
  ****/ 
  
 #ifndef ELEMENT_DRAGON_H
 #define ELEMENT_DRAGON_H
 #include <avr/pgmspace.h>
 #include <Adafruit_NeoPixel.h>
-#include "GimpLedPattern.h"
+#include "DeltaLedPattern.h"
 
 #define ELEMENT_DRAGON_DELAY 200
 
 #define ELEMENT_DRAGON_TOTAL_LEDS 20
 
-namespace NS_ELEMENT_DRAGON {
-
-	const uint32_t BACKGROUND_COPY[] PROGMEM = { 
-	0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 
-	0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8, 0xec13f8
-
-		};
-
-	const uint32_t BACKGROUND_COPY_1[] PROGMEM = { 
-	0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 
-	0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9
-
-		};
+#define ELEMENT_DRAGON_TOTAL_FRAMES 8
 
-	const uint32_t BACKGROUND[] PROGMEM = { 
-	0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 
-	0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b
+#define ELEMENT_DRAGON_KEYFRAME_INTERVAL 8
 
-		};
-
-	const uint32_t BACKGROUND_COPY_2[] PROGMEM = { 
-	0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 
-	0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d
-
-		};
-
-	const uint32_t BACKGROUND_COPY_3[] PROGMEM = { 
-	0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 
-	0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224, 0x230224
-
-		};
-
-	const uint32_t BACKGROUND_COPY_4[] PROGMEM = { 
-	0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 
-	0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d, 0x3a043d
-
-		};
-
-	const uint32_t BACKGROUND_COPY_5[] PROGMEM = { 
-	0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 
-	0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b, 0x75097b
-
-		};
+namespace NS_ELEMENT_DRAGON {
 
-	const uint32_t BACKGROUND_COPY_6[] PROGMEM = { 
-	0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 
-	0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9, 0xb00eb9
+	// 8 frames, 1 keyframes, 56 bytes (640 bytes as frame tables).
+	const uint8_t ELEMENT_DRAGON_STREAM[] PROGMEM = { 
+	0x01, 0x00, 0x00, 0x93, 0xec, 0x13, 0xf8, 0x01, 0x00, 0x00, 0x93, 0xb0, 0x0e, 0xb9, 0x01, 0x00, 
+	0x00, 0x93, 0x75, 0x09, 0x7b, 0x01, 0x00, 0x00, 0x93, 0x3a, 0x04, 0x3d, 0x01, 0x00, 0x00, 0x93, 
+	0x23, 0x02, 0x24, 0x01, 0x00, 0x00, 0x93, 0x3a, 0x04, 0x3d, 0x01, 0x00, 0x00, 0x93, 0x75, 0x09, 
+	0x7b, 0x01, 0x00, 0x00, 0x93, 0xb0, 0x0e, 0xb9
 
 		};
 
-	const uint32_t *const ELEMENT_DRAGON[] PROGMEM = { 
-	BACKGROUND_COPY,
-	BACKGROUND_COPY_1,
-	BACKGROUND,
-	BACKGROUND_COPY_2,
-	BACKGROUND_COPY_3,
-	BACKGROUND_COPY_4,
-	BACKGROUND_COPY_5,
-	BACKGROUND_COPY_6,
-	};
-
-	const uint32_t ELEMENT_DRAGON_SIZES[] PROGMEM = { 
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
+	const uint32_t ELEMENT_DRAGON_KEYFRAMES[] PROGMEM = { 
+	0,
 	};
 
 }
@@ -92,49 +38,14 @@ namespace NS_ELEMENT_DRAGON {
 using namespace NS_ELEMENT_DRAGON;
 
 		
-class Pattern_ELEMENT_DRAGON : public GimpLedPattern 
+class Pattern_ELEMENT_DRAGON : public DeltaLedPattern 
 {
 
   public:
-    Pattern_ELEMENT_DRAGON(Adafruit_NeoPixel& strip): GimpLedPattern(strip){}
+    Pattern_ELEMENT_DRAGON(Adafruit_NeoPixel& strip)
+      : DeltaLedPattern(strip, ELEMENT_DRAGON_STREAM, ELEMENT_DRAGON_KEYFRAMES, ELEMENT_DRAGON_TOTAL_FRAMES, ELEMENT_DRAGON_KEYFRAME_INTERVAL, ELEMENT_DRAGON_DELAY){}
 
     ~Pattern_ELEMENT_DRAGON(){}
-
-    void playPattern() 
-    {
-      int totalFrames = sizeof(ELEMENT_DRAGON) / sizeof(uint32_t*);
-      for (int framePos = 0; framePos < totalFrames; framePos ++)
-      {
-        int frameTotalLeds = pgm_read_dword(&(ELEMENT_DRAGON_SIZES[framePos]));
-		int ledOffset = 0;
-        for (int ledPos = 0; ledPos < frameTotalLeds; ledPos++)
-        {
-          if(mInterrupt)
-          {
-            // If we are interrupted stop the pattern. "Clean" LED pattern.
-            mStrip.clear();
-            mStrip.show();
-            mInterrupt = false;
-            return;
-          }
-          uint32_t ledColor = pgm_read_dword(&(ELEMENT_DRAGON[framePos][ledPos]));
-          int blue = ledColor & 0x00FF;
-          int green = (ledColor >> 8) & 0x00FF;
-          int red = (ledColor >>  16) & 0x00FF;
-          mStrip.setPixelColor(ledPos + ledOffset, red, green, blue);
-
-        }
-        mStrip.show();
-        delay(ELEMENT_DRAGON_DELAY);
-      }
-    }
-
-    
-    void stopPattern() 
-    {
-      mInterrupt = true;
-    }
 };
 		
 #endif //ELEMENT_DRAGON_H
-
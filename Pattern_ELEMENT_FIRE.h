@@ -1,90 +1,36 @@
 
 /****
- * Pattern file Generated from a Gimp Image file using the Gimp LEDs plug-in.
- * Gimp LEDs Plug-in Download: https://bit.ly/GimpLeds
- * Gimp Download: https://www.gimp.org
+ * Pattern file generated from GimpFiles/Element_Fire.xcf by tools/xcf2pattern.
+ * Delta encoded, see DeltaLedPattern.h for the stream layout.
  ****/ 
  
 #ifndef ELEMENT_FIRE_H
 #define ELEMENT_FIRE_H
 #include <avr/pgmspace.h>
 #include <Adafruit_NeoPixel.h>
-#include "GimpLedPattern.h"
+#include "DeltaLedPattern.h"
 
 #define ELEMENT_FIRE_DELAY 200
 
 #define ELEMENT_FIRE_TOTAL_LEDS 20
 
-namespace NS_ELEMENT_FIRE {
-
-	const uint32_t BACKGROUND_COPY[] PROGMEM = { 
-	0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 
-	0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000
-
-		};
-
-	const uint32_t BACKGROUND_COPY_5[] PROGMEM = { 
-	0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 
-	0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000
-
-		};
+#define ELEMENT_FIRE_TOTAL_FRAMES 8
 
-	const uint32_t BACKGROUND[] PROGMEM = { 
-	0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 
-	0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000
+#define ELEMENT_FIRE_KEYFRAME_INTERVAL 8
 
-		};
-
-	const uint32_t BACKGROUND_COPY_3[] PROGMEM = { 
-	0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 
-	0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000
-
-		};
-
-	const uint32_t BACKGROUND_COPY_6[] PROGMEM = { 
-	0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 
-	0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000, 0x260000
-
-		};
-
-	const uint32_t BACKGROUND_COPY_4[] PROGMEM = { 
-	0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 
-	0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000, 0x3f0000
-
-		};
-
-	const uint32_t BACKGROUND_COPY_2[] PROGMEM = { 
-	0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 
-	0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000, 0x7f0000
-
-		};
+namespace NS_ELEMENT_FIRE {
 
-	const uint32_t BACKGROUND_COPY_1[] PROGMEM = { 
-	0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 
-	0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000, 0xbf0000
+	// 8 frames, 1 keyframes, 56 bytes (640 bytes as frame tables).
+	const uint8_t ELEMENT_FIRE_STREAM[] PROGMEM = { 
+	0x01, 0x00, 0x00, 0x93, 0xff, 0x00, 0x00, 0x01, 0x00, 0x00, 0x93, 0xbf, 0x00, 0x00, 0x01, 0x00, 
+	0x00, 0x93, 0x7f, 0x00, 0x00, 0x01, 0x00, 0x00, 0x93, 0x3f, 0x00, 0x00, 0x01, 0x00, 0x00, 0x93, 
+	0x26, 0x00, 0x00, 0x01, 0x00, 0x00, 0x93, 0x3f, 0x00, 0x00, 0x01, 0x00, 0x00, 0x93, 0x7f, 0x00, 
+	0x00, 0x01, 0x00, 0x00, 0x93, 0xbf, 0x00, 0x00
 
 		};
 
-	const uint32_t *const ELEMENT_FIRE[] PROGMEM = { 
-	BACKGROUND_COPY,
-	BACKGROUND_COPY_5,
-	BACKGROUND,
-	BACKGROUND_COPY_3,
-	BACKGROUND_COPY_6,
-	BACKGROUND_COPY_4,
-	BACKGROUND_COPY_2,
-	BACKGROUND_COPY_1,
-	};
-
-	const uint32_t ELEMENT_FIRE_SIZES[] PROGMEM = { 
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
+	const uint32_t ELEMENT_FIRE_KEYFRAMES[] PROGMEM = { 
+	0,
 	};
 
 }
@@ -92,49 +38,14 @@ namespace NS_ELEMENT_FIRE {
 using namespace NS_ELEMENT_FIRE;
 
 		
-class Pattern_ELEMENT_FIRE : public GimpLedPattern 
+class Pattern_ELEMENT_FIRE : public DeltaLedPattern 
 {
 
   public:
-    Pattern_ELEMENT_FIRE(Adafruit_NeoPixel& strip): GimpLedPattern(strip){}
+    Pattern_ELEMENT_FIRE(Adafruit_NeoPixel& strip)
+      : DeltaLedPattern(strip, ELEMENT_FIRE_STREAM, ELEMENT_FIRE_KEYFRAMES, ELEMENT_FIRE_TOTAL_FRAMES, ELEMENT_FIRE_KEYFRAME_INTERVAL, ELEMENT_FIRE_DELAY){}
 
     ~Pattern_ELEMENT_FIRE(){}
-
-    void playPattern() 
-    {
-      int totalFrames = sizeof(ELEMENT_FIRE) / sizeof(uint32_t*);
-      for (int framePos = 0; framePos < totalFrames; framePos ++)
-      {
-        int frameTotalLeds = pgm_read_dword(&(ELEMENT_FIRE_SIZES[framePos]));
-		int ledOffset = 0;
-        for (int ledPos = 0; ledPos < frameTotalLeds; ledPos++)
-        {
-          if(mInterrupt)
-          {
-            // If we are interrupted stop the pattern. "Clean" LED pattern.
-            mStrip.clear();
-            mStrip.show();
-            mInterrupt = false;
-            return;
-          }
-          uint32_t ledColor = pgm_read_dword(&(ELEMENT_FIRE[framePos][ledPos]));
-          int blue = ledColor & 0x00FF;
-          int green = (ledColor >> 8) & 0x00FF;
-          int red = (ledColor >>  16) & 0x00FF;
-          mStrip.setPixelColor(ledPos + ledOffset, red, green, blue);
-
-        }
-        mStrip.show();
-        delay(ELEMENT_FIRE_DELAY);
-      }
-    }
-
-    
-    void stopPattern() 
-    {
-      mInterrupt = true;
-    }
 };
 		
 #endif //ELEMENT_FIRE_H
-
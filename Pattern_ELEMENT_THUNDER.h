@@ -1,90 +1,36 @@
 
 /****
- * Pattern file Generated from a Gimp Image file using the Gimp LEDs plug-in.
- * Gimp LEDs Plug-in Download: https://bit.ly/GimpLeds
- * Gimp Download: https://www.gimp.org
+ * Pattern file generated from GimpFiles/Element_Thunder.xcf by tools/xcf2pattern.
+ * Delta encoded, see DeltaLedPattern.h for the stream layout.
  ****/ 
  
 #ifndef ELEMENT_THUNDER_H
 #define ELEMENT_THUNDER_H
 #include <avr/pgmspace.h>
 #include <Adafruit_NeoPixel.h>
-#include "GimpLedPattern.h"
+#include "DeltaLedPattern.h"
 
 #define ELEMENT_THUNDER_DELAY 200
 
 #define ELEMENT_THUNDER_TOTAL_LEDS 20
 
-namespace NS_ELEMENT_THUNDER {
-
-	const uint32_t BACKGROUND_COPY_7[] PROGMEM = { 
-	0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 
-	0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600, 0xffe600
-
-		};
-
-	const uint32_t BACKGROUND_COPY_6[] PROGMEM = { 
-	0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 
-	0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00
-
-		};
+#define ELEMENT_THUNDER_TOTAL_FRAMES 8
 
-	const uint32_t BACKGROUND_COPY_5[] PROGMEM = { 
-	0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 
-	0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200
+#define ELEMENT_THUNDER_KEYFRAME_INTERVAL 8
 
-		};
-
-	const uint32_t BACKGROUND_COPY_4[] PROGMEM = { 
-	0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 
-	0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800
-
-		};
-
-	const uint32_t BACKGROUND_COPY_3[] PROGMEM = { 
-	0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 
-	0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200, 0x262200
-
-		};
-
-	const uint32_t BACKGROUND_COPY_2[] PROGMEM = { 
-	0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 
-	0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800, 0x3f3800
-
-		};
-
-	const uint32_t BACKGROUND_COPY_1[] PROGMEM = { 
-	0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 
-	0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200, 0x7f7200
-
-		};
+namespace NS_ELEMENT_THUNDER {
 
-	const uint32_t BACKGROUND_COPY[] PROGMEM = { 
-	0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 
-	0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00, 0xbfac00
+	// 8 frames, 1 keyframes, 56 bytes (640 bytes as frame tables).
+	const uint8_t ELEMENT_THUNDER_STREAM[] PROGMEM = { 
+	0x01, 0x00, 0x00, 0x93, 0xff, 0xe6, 0x00, 0x01, 0x00, 0x00, 0x93, 0xbf, 0xac, 0x00, 0x01, 0x00, 
+	0x00, 0x93, 0x7f, 0x72, 0x00, 0x01, 0x00, 0x00, 0x93, 0x3f, 0x38, 0x00, 0x01, 0x00, 0x00, 0x93, 
+	0x26, 0x22, 0x00, 0x01, 0x00, 0x00, 0x93, 0x3f, 0x38, 0x00, 0x01, 0x00, 0x00, 0x93, 0x7f, 0x72, 
+	0x00, 0x01, 0x00, 0x00, 0x93, 0xbf, 0xac, 0x00
 
 		};
 
-	const uint32_t *const ELEMENT_THUNDER[] PROGMEM = { 
-	BACKGROUND_COPY_7,
-	BACKGROUND_COPY_6,
-	BACKGROUND_COPY_5,
-	BACKGROUND_COPY_4,
-	BACKGROUND_COPY_3,
-	BACKGROUND_COPY_2,
-	BACKGROUND_COPY_1,
-	BACKGROUND_COPY,
-	};
-
-	const uint32_t ELEMENT_THUNDER_SIZES[] PROGMEM = { 
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
-	20,
+	const uint32_t ELEMENT_THUNDER_KEYFRAMES[] PROGMEM = { 
+	0,
 	};
 
 }
@@ -92,49 +38,14 @@ namespace NS_ELEMENT_THUNDER {
 using namespace NS_ELEMENT_THUNDER;
 
 		
-class Pattern_ELEMENT_THUNDER : public GimpLedPattern 
+class Pattern_ELEMENT_THUNDER : public DeltaLedPattern 
 {
 
   public:
-    Pattern_ELEMENT_THUNDER(Adafruit_NeoPixel& strip): GimpLedPattern(strip){}
+    Pattern_ELEMENT_THUNDER(Adafruit_NeoPixel& strip)
+      : DeltaLedPattern(strip, ELEMENT_THUNDER_STREAM, ELEMENT_THUNDER_KEYFRAMES, ELEMENT_THUNDER_TOTAL_FRAMES, ELEMENT_THUNDER_KEYFRAME_INTERVAL, ELEMENT_THUNDER_DELAY){}
 
     ~Pattern_ELEMENT_THUNDER(){}
-
-    void playPattern() 
-    {
-      int totalFrames = sizeof(ELEMENT_THUNDER) / sizeof(uint32_t*);
-      for (int framePos = 0; framePos < totalFrames; framePos ++)
-      {
-        int frameTotalLeds = pgm_read_dword(&(ELEMENT_THUNDER_SIZES[framePos]));
-		int ledOffset = 0;
-        for (int ledPos = 0; ledPos < frameTotalLeds; ledPos++)
-        {
-          if(mInterrupt)
-          {
-            // If we are interrupted stop the pattern. "Clean" LED pattern.
-            mStrip.clear();
-            mStrip.show();
-            mInterrupt = false;
-            return;
-          }
-          uint32_t ledColor = pgm_read_dword(&(ELEMENT_THUNDER[framePos][ledPos]));
-          int blue = ledColor & 0x00FF;
-          int green = (ledColor >> 8) & 0x00FF;
-          int red = (ledColor >>  16) & 0x00FF;
-          mStrip.setPixelColor(ledPos + ledOffset, red, green, blue);
-
-        }
-        mStrip.show();
-        delay(ELEMENT_THUNDER_DELAY);
-      }
-    }
-
-    
-    void stopPattern() 
-    {
-      mInterrupt = true;
-    }
 };
 		
 #endif //ELEMENT_THUNDER_H
-
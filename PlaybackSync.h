@@ -0,0 +1,332 @@
+#ifndef PLAYBACK_SYNC_H
+#define PLAYBACK_SYNC_H
+#include <stdint.h>
+#include <string.h>
+#include "SyncTransport.h"
+
+// Sync messages use the same [command][tag][payload...] layout as the
+// pattern characteristic.
+#define SYNC_CMD_TIME 0x20      // [0x20][tag][master time u32]
+#define SYNC_CMD_START_AT 0x21  // [0x21][tag][pattern id][master start time u32]
+
+// Timebase samples are grouped in windows, the sample with the lowest
+// link latency in each window is used to update the clock model.
+#define SYNC_WINDOW_SIZE 8
+
+// Number of windows the offset estimate is taken over.
+#define SYNC_HISTORY_SIZE 8
+
+// Drift estimates beyond this are clamped.
+#define SYNC_MAX_DRIFT_PPB 1000000L
+
+// How often a leader broadcasts its timebase.
+#define SYNC_LEADER_INTERVAL_MS 250
+
+/**
+ * Offset and drift estimate from the local millis() to the shared
+ * (master) timebase.
+ */
+class SyncClock
+{
+  public:
+    SyncClock() {}
+
+    ~SyncClock() {}
+
+    // masterTime is the master clock when the message was sent,
+    // localTime is millis() when it was received.
+    void addSample(uint32_t masterTime, uint32_t localTime)
+    {
+      // Latency only ever makes the apparent offset smaller, so the
+      // largest offset in the window is the closest to the real one.
+      int32_t offset = (int32_t)(masterTime - localTime);
+      if (mWindowCount == 0 || offset > mWindowBestOffset)
+      {
+        mWindowBestOffset = offset;
+        mWindowBestLocal = localTime;
+      }
+      mWindowCount++;
+
+      if (mWindows == 0)
+      {
+        // Until the first window is complete follow the best sample so far.
+        mOffset = mWindowBestOffset;
+        mRefLocal = mWindowBestLocal;
+        mSynced = true;
+      }
+
+      if (mWindowCount >= SYNC_WINDOW_SIZE)
+      {
+        closeWindow();
+      }
+    }
+
+    uint32_t toMaster(uint32_t localTime)
+    {
+      int32_t sinceRef = (int32_t)(localTime - mRefLocal);
+      int32_t driftCorrection = (int32_t)(((int64_t)sinceRef * mDriftPpb) / 1000000000LL);
+      return localTime + mOffset + driftCorrection;
+    }
+
+    bool isSynced()
+    {
+      return mSynced;
+    }
+
+    int32_t getOffset()
+    {
+      return mOffset;
+    }
+
+    int32_t getDriftPpb()
+    {
+      return mDriftPpb;
+    }
+
+    void reset()
+    {
+      mSynced = false;
+      mOffset = 0;
+      mDriftPpb = 0;
+      mRefLocal = 0;
+      mWindows = 0;
+      mWindowCount = 0;
+      mHasBase = false;
+      mHistoryPos = 0;
+      mHistoryCount = 0;
+    }
+
+  private:
+    bool mSynced = false;
+    int32_t mOffset = 0;
+    int32_t mDriftPpb = 0;
+    uint32_t mRefLocal = 0;
+
+    bool mHasBase = false;
+    int32_t mBaseOffset = 0;
+    uint32_t mBaseLocal = 0;
+
+    uint32_t mHistoryLocal[SYNC_HISTORY_SIZE];
+    int32_t mHistoryOffset[SYNC_HISTORY_SIZE];
+    uint8_t mHistoryPos = 0;
+    uint8_t mHistoryCount = 0;
+
+    uint16_t mWindows = 0;
+    uint8_t mWindowCount = 0;
+    int32_t mWindowBestOffset = 0;
+    uint32_t mWindowBestLocal = 0;
+
+    void closeWindow()
+    {
+      mHistoryLocal[mHistoryPos] = mWindowBestLocal;
+      mHistoryOffset[mHistoryPos] = mWindowBestOffset;
+      mHistoryPos = (mHistoryPos + 1) % SYNC_HISTORY_SIZE;
+      if (mHistoryCount < SYNC_HISTORY_SIZE)
+      {
+        mHistoryCount++;
+      }
+
+      // Upper envelope of the recent windows, brought forward with the
+      // current drift estimate. One window where every message was
+      // delayed doesn't pull the offset down.
+      int32_t offset = mWindowBestOffset;
+      for (uint8_t i = 0; i < mHistoryCount; i++)
+      {
+        int32_t sinceWindow = (int32_t)(mWindowBestLocal - mHistoryLocal[i]);
+        int32_t projected = mHistoryOffset[i] + (int32_t)(((int64_t)sinceWindow * mDriftPpb) / 1000000000LL);
+        if (projected > offset)
+        {
+          offset = projected;
+        }
+      }
+
+      if (!mHasBase)
+      {
+        if (mHistoryCount == SYNC_HISTORY_SIZE)
+        {
+          mBaseOffset = offset;
+          mBaseLocal = mWindowBestLocal;
+          mHasBase = true;
+        }
+      }
+      else
+      {
+        // Measured against a fixed base so the estimate gets more precise
+        // the longer the props stay in sync.
+        int32_t elapsed = (int32_t)(mWindowBestLocal - mBaseLocal);
+        if (elapsed > 0)
+        {
+          int64_t drift = ((int64_t)(offset - mBaseOffset) * 1000000000LL) / elapsed;
+          if (drift > SYNC_MAX_DRIFT_PPB)
+          {
+            drift = SYNC_MAX_DRIFT_PPB;
+          }
+          else if (drift < -SYNC_MAX_DRIFT_PPB)
+          {
+            drift = -SYNC_MAX_DRIFT_PPB;
+          }
+          mDriftPpb = (int32_t)drift;
+        }
+      }
+
+      mOffset = offset;
+      mRefLocal = mWindowBestLocal;
+      mWindows++;
+      mWindowCount = 0;
+    }
+};
+
+typedef void (*sync_start_callback_t) (uint8_t patternId, uint32_t showTime);
+
+/**
+ * Keeps several props on one timebase. Followers estimate the leader's
+ * clock from SYNC_CMD_TIME messages and start patterns at the agreed
+ * show time, the leader (phone or a lead prop) broadcasts both.
+ */
+class PlaybackSync
+{
+  public:
+    PlaybackSync(SyncTransport& transport, sync_start_callback_t startCallback): mTransport(transport)
+    {
+      mStart_cb = startCallback;
+    }
+
+    ~PlaybackSync() {}
+
+    void setLeader(bool leader)
+    {
+      mLeader = leader;
+    }
+
+    bool isLeader()
+    {
+      return mLeader;
+    }
+
+    // Converts millis() to the shared show time, which the player and
+    // sequencer should run on. Without a timebase this is just millis().
+    uint32_t toShowTime(uint32_t localTime)
+    {
+      if (mLeader || !mClock.isSynced())
+      {
+        return localTime;
+      }
+      return mClock.toMaster(localTime);
+    }
+
+    // Call from loop() with millis().
+    void update(uint32_t now)
+    {
+      SyncMessage message;
+      while (mTransport.receive(message))
+      {
+        handleMessage(message);
+      }
+
+      // A start time is on the leader's clock, it waits until that clock
+      // is known here. A start time already past starts at the frame due.
+      if (mHasPendingStart && (mLeader || mClock.isSynced()))
+      {
+        mHasPendingStart = false;
+        mStart_cb(mPendingStartId, mPendingStartTime);
+      }
+
+      // The show time jumps when the clock locks onto (or leaves) a timebase.
+      bool locked = !mLeader && mClock.isSynced();
+      int32_t showOffset = (int32_t)(toShowTime(now) - now);
+      mTimebaseStep = locked != mLocked ? showOffset - mShowOffset : 0;
+      mLocked = locked;
+      mShowOffset = showOffset;
+
+      if (mLeader && (now - mLastBroadcast) >= SYNC_LEADER_INTERVAL_MS)
+      {
+        mLastBroadcast = now;
+        uint8_t timeMessage[6] = { SYNC_CMD_TIME, mSequence++ };
+        writeUint32(timeMessage + 2, now);
+        mTransport.send(timeMessage, sizeof(timeMessage));
+      }
+    }
+
+    // Leader only, tells every follower to start patternId at showTime
+    // and starts it locally at the same time.
+    void startAt(uint8_t patternId, uint32_t showTime)
+    {
+      uint8_t startMessage[7] = { SYNC_CMD_START_AT, mSequence++, patternId };
+      writeUint32(startMessage + 3, showTime);
+      mTransport.send(startMessage, sizeof(startMessage));
+
+      if (mStart_cb != NULL)
+      {
+        mStart_cb(patternId, showTime);
+      }
+    }
+
+    // How far the show time jumped in the last update() on top of the
+    // time that passed, 0 unless the timebase was just taken up or dropped.
+    // The frame in play was picked on the old show time, so the player and
+    // sequencer should be moved along (PatternPlayer::shiftTime()).
+    int32_t getTimebaseStep()
+    {
+      return mTimebaseStep;
+    }
+
+    SyncClock& getClock()
+    {
+      return mClock;
+    }
+
+  private:
+    SyncTransport& mTransport;
+    SyncClock mClock;
+    sync_start_callback_t mStart_cb = NULL;
+    bool mLeader = false;
+    uint8_t mSequence = 0;
+    uint32_t mLastBroadcast = 0;
+    bool mHasPendingStart = false;
+    uint8_t mPendingStartId = 0;
+    uint32_t mPendingStartTime = 0;
+    bool mLocked = false;
+    int32_t mShowOffset = 0;
+    int32_t mTimebaseStep = 0;
+
+    void handleMessage(SyncMessage& message)
+    {
+      if (message.len < 2)
+      {
+        return;
+      }
+
+      switch (message.data[0])
+      {
+        case SYNC_CMD_TIME:
+          if (message.len >= 6 && !mLeader)
+          {
+            mClock.addSample(readUint32(message.data + 2), message.receivedAt);
+          }
+          break;
+        case SYNC_CMD_START_AT:
+          if (message.len >= 7 && mStart_cb != NULL)
+          {
+            mPendingStartId = message.data[2];
+            mPendingStartTime = readUint32(message.data + 3);
+            mHasPendingStart = true;
+          }
+          break;
+      }
+    }
+
+    static uint32_t readUint32(const uint8_t * data)
+    {
+      return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+
+    static void writeUint32(uint8_t * data, uint32_t value)
+    {
+      data[0] = value & 0xFF;
+      data[1] = (value >> 8) & 0xFF;
+      data[2] = (value >> 16) & 0xFF;
+      data[3] = (value >> 24) & 0xFF;
+    }
+};
+
+#endif
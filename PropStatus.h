@@ -0,0 +1,80 @@
+#ifndef PROP_STATUS_H
+#define PROP_STATUS_H
+#include <stdint.h>
+#include <string.h>
+
+// Minimum time between two status notifications.
+#define STATUS_NOTIFY_INTERVAL_MS 250
+
+// Bits of PropStatus::flags.
+#define STATUS_FLAG_PLAYLIST 0x01 // a sequencer playlist is running
+#define STATUS_FLAG_SYNCED 0x02   // playing on a shared timebase
+#define STATUS_FLAG_LEADER 0x04   // broadcasting the shared timebase
+
+/**
+ * Playback status as sent on the status characteristic, little endian.
+ */
+struct __attribute__((packed)) PropStatus
+{
+  uint8_t patternId;
+  uint8_t state;     // PlayerState
+  uint16_t framePos; // 0xFFFF before the first frame
+  uint8_t flags;
+  uint8_t lastTag;   // tag of the last command that was accepted
+  uint8_t battery;   // percent
+  uint16_t framesDropped; // since the last stats reset, saturates
+  uint16_t maxOverrunMs;  // latest a frame reached the strip
+};
+
+typedef void (*status_send_callback_t) (const uint8_t * data, uint16_t len);
+
+/**
+ * Coalesces status updates: a notification is only sent when the status
+ * changed, at most every STATUS_NOTIFY_INTERVAL_MS, and never right after
+ * a command came in so it doesn't compete with command traffic.
+ */
+class PropStatusNotifier
+{
+  public:
+    PropStatusNotifier(status_send_callback_t sendCallback)
+    {
+      mSend_cb = sendCallback;
+      memset(&mSent, 0, sizeof(mSent));
+    }
+
+    ~PropStatusNotifier() {}
+
+    // Postpones the next notification by a full interval. Safe to call
+    // from the BLE callbacks.
+    void holdOff(uint32_t now)
+    {
+      mLastSend = now;
+    }
+
+    // Call from loop() with the current status.
+    void update(uint32_t now, const PropStatus& status)
+    {
+      if ((now - mLastSend) < STATUS_NOTIFY_INTERVAL_MS)
+      {
+        return;
+      }
+
+      if (mHasSent && memcmp(&status, &mSent, sizeof(PropStatus)) == 0)
+      {
+        return;
+      }
+
+      mSent = status;
+      mHasSent = true;
+      mLastSend = now;
+      mSend_cb((const uint8_t *)&mSent, sizeof(PropStatus));
+    }
+
+  private:
+    status_send_callback_t mSend_cb = NULL;
+    PropStatus mSent;
+    bool mHasSent = false;
+    volatile uint32_t mLastSend = 0;
+};
+
+#endif
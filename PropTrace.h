@@ -0,0 +1,238 @@
+#ifndef PROP_TRACE_H
+#define PROP_TRACE_H
+#include <Arduino.h>
+
+// RAM used for the trace, the oldest records are dropped when it is full.
+#ifndef TRACE_BUFFER_BYTES
+#define TRACE_BUFFER_BYTES 2048
+#endif
+
+// Every record is [type][payload len][time, 4 bytes little endian][payload].
+#define TRACE_HEADER_LEN 6
+#define TRACE_MAX_PAYLOAD 128
+
+enum TraceRecordType
+{
+  TRACE_START = 1,     // [pattern id] playing when recording started
+  TRACE_BLE_WRITE = 2, // [conn lo][conn hi][uuid lo][uuid hi][data...]
+  TRACE_ACTIVATE = 3,  // [pattern id], 0 = off
+  TRACE_SHOW = 4       // [pattern id][frame lo][frame hi], frame 0xFFFF = cleared
+};
+
+struct TraceRecord
+{
+  uint8_t type;
+  uint8_t len;
+  uint32_t time;
+  uint8_t data[TRACE_MAX_PAYLOAD];
+};
+
+/**
+ * Records what the prop received and rendered into a RAM ring so a
+ * session can be dumped over serial. Records are written as
+ * "TR <hex bytes>" lines. tools/propreplay replays the BLE writes of a
+ * dump through the sketch on a PC and tools/proptrace decodes and
+ * compares them. Safe to record from the BLE callbacks: the ring is
+ * updated in a FreeRTOS critical section, which leaves the SoftDevice's
+ * interrupts running.
+ */
+class PropTrace
+{
+  public:
+    PropTrace() {}
+
+    ~PropTrace() {}
+
+    // Clears the trace and starts recording.
+    void start(uint32_t now, uint8_t patternId)
+    {
+      clear();
+      mRecording = true;
+      append(TRACE_START, now, &patternId, 1);
+    }
+
+    void stop()
+    {
+      mRecording = false;
+    }
+
+    bool isRecording()
+    {
+      return mRecording;
+    }
+
+    void clear()
+    {
+      taskENTER_CRITICAL();
+      mHead = 0;
+      mTail = 0;
+      mUsed = 0;
+      mDropped = 0;
+      taskEXIT_CRITICAL();
+    }
+
+    // Also prints every record as it happens, recording or not.
+    void setEcho(Print * out)
+    {
+      mEcho = out;
+    }
+
+    void recordWrite(uint32_t now, uint16_t connHandle, uint16_t uuid, const uint8_t * data, uint16_t len)
+    {
+      uint8_t payload[TRACE_MAX_PAYLOAD];
+      if (len > TRACE_MAX_PAYLOAD - 4)
+      {
+        len = TRACE_MAX_PAYLOAD - 4;
+      }
+      payload[0] = connHandle;
+      payload[1] = connHandle >> 8;
+      payload[2] = uuid;
+      payload[3] = uuid >> 8;
+      memcpy(payload + 4, data, len);
+      append(TRACE_BLE_WRITE, now, payload, len + 4);
+    }
+
+    void recordActivate(uint32_t now, uint8_t patternId)
+    {
+      append(TRACE_ACTIVATE, now, &patternId, 1);
+    }
+
+    void recordShow(uint32_t now, uint8_t patternId, int framePos)
+    {
+      uint8_t payload[3] = { patternId, (uint8_t)framePos, (uint8_t)(framePos >> 8) };
+      append(TRACE_SHOW, now, payload, 3);
+    }
+
+    // Prints the whole trace, oldest record first.
+    void dump(Print& out)
+    {
+      out.print("TRACE BEGIN ");
+      out.println(mDropped);
+      TraceRecord record;
+      rewind();
+      while (next(record))
+      {
+        printRecord(out, record);
+      }
+      out.println("TRACE END");
+    }
+
+    // Reading back, only while not recording.
+    void rewind()
+    {
+      mReadPos = mTail;
+      mReadLeft = mUsed;
+    }
+
+    bool next(TraceRecord& record)
+    {
+      if (mReadLeft < TRACE_HEADER_LEN)
+      {
+        return false;
+      }
+      record.type = readByte();
+      record.len = readByte();
+      record.time = 0;
+      for (uint8_t i = 0; i < 4; i++)
+      {
+        record.time |= (uint32_t)readByte() << (8 * i);
+      }
+      for (uint8_t i = 0; i < record.len; i++)
+      {
+        record.data[i] = readByte();
+      }
+      mReadLeft -= TRACE_HEADER_LEN + record.len;
+      return true;
+    }
+
+  private:
+    uint8_t mBuffer[TRACE_BUFFER_BYTES];
+    uint16_t mHead = 0;
+    uint16_t mTail = 0;
+    uint16_t mUsed = 0;
+    uint16_t mDropped = 0;
+    volatile bool mRecording = false;
+    Print * mEcho = NULL;
+
+    uint16_t mReadPos = 0;
+    uint16_t mReadLeft = 0;
+
+    void append(uint8_t type, uint32_t now, const uint8_t * payload, uint8_t len)
+    {
+      if (mEcho != NULL)
+      {
+        TraceRecord record;
+        record.type = type;
+        record.len = len;
+        record.time = now;
+        memcpy(record.data, payload, len);
+        printRecord(*mEcho, record);
+      }
+
+      if (!mRecording)
+      {
+        return;
+      }
+
+      uint16_t size = TRACE_HEADER_LEN + len;
+      taskENTER_CRITICAL();
+      while (TRACE_BUFFER_BYTES - mUsed < size)
+      {
+        // Make room by dropping the oldest record.
+        uint16_t oldSize = TRACE_HEADER_LEN + mBuffer[(mTail + 1) % TRACE_BUFFER_BYTES];
+        mTail = (mTail + oldSize) % TRACE_BUFFER_BYTES;
+        mUsed -= oldSize;
+        mDropped++;
+      }
+
+      writeByte(type);
+      writeByte(len);
+      for (uint8_t i = 0; i < 4; i++)
+      {
+        writeByte(now >> (8 * i));
+      }
+      for (uint8_t i = 0; i < len; i++)
+      {
+        writeByte(payload[i]);
+      }
+      mUsed += size;
+      taskEXIT_CRITICAL();
+    }
+
+    void writeByte(uint8_t value)
+    {
+      mBuffer[mHead] = value;
+      mHead = (mHead + 1) % TRACE_BUFFER_BYTES;
+    }
+
+    uint8_t readByte()
+    {
+      uint8_t value = mBuffer[mReadPos];
+      mReadPos = (mReadPos + 1) % TRACE_BUFFER_BYTES;
+      return value;
+    }
+
+    static void printRecord(Print& out, const TraceRecord& record)
+    {
+      uint8_t header[TRACE_HEADER_LEN] = { record.type, record.len,
+        (uint8_t)record.time, (uint8_t)(record.time >> 8),
+        (uint8_t)(record.time >> 16), (uint8_t)(record.time >> 24) };
+
+      out.print("TR ");
+      printHex(out, header, TRACE_HEADER_LEN);
+      printHex(out, record.data, record.len);
+      out.println();
+    }
+
+    static void printHex(Print& out, const uint8_t * data, uint8_t len)
+    {
+      static const char digits[] = "0123456789abcdef";
+      for (uint8_t i = 0; i < len; i++)
+      {
+        out.write(digits[data[i] >> 4]);
+        out.write(digits[data[i] & 0x0F]);
+      }
+    }
+};
+
+#endif
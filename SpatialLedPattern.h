@@ -0,0 +1,133 @@
+#ifndef SPATIAL_LED_PATTERN_H
+#define SPATIAL_LED_PATTERN_H
+#include <avr/pgmspace.h>
+#include <Adafruit_NeoPixel.h>
+#include "GimpLedPattern.h"
+#include "LedLayout.h"
+
+// Number of frames in one cycle of a spatial effect.
+#define SPATIAL_TOTAL_FRAMES 32
+
+enum SpatialEffect
+{
+  SPATIAL_WAVE_X = 0, // travels along x, e.g. head to tail
+  SPATIAL_WAVE_Y = 1, // travels along y
+  SPATIAL_RADIAL = 2, // rings moving out from the layout centre
+  SPATIAL_SWEEP = 3   // rotates around the layout centre
+};
+
+// One period of a sine wave scaled to 0-255.
+const uint8_t SPATIAL_WAVE_LUT[256] PROGMEM = {
+  128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+  176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+  218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+  245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+  255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+  245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+  218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+  176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+  128, 124, 121, 118, 115, 112, 109, 106, 103, 100, 97, 93, 90, 88, 85, 82,
+  79, 76, 73, 70, 67, 65, 62, 59, 57, 54, 52, 49, 47, 44, 42, 40,
+  37, 35, 33, 31, 29, 27, 25, 23, 21, 20, 18, 17, 15, 14, 12, 11,
+  10, 9, 7, 6, 5, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0,
+  0, 0, 0, 0, 1, 1, 1, 2, 2, 3, 4, 5, 5, 6, 7, 9,
+  10, 11, 12, 14, 15, 17, 18, 20, 21, 23, 25, 27, 29, 31, 33, 35,
+  37, 40, 42, 44, 47, 49, 52, 54, 57, 59, 62, 65, 67, 70, 73, 76,
+  79, 82, 85, 88, 90, 93, 97, 100, 103, 106, 109, 112, 115, 118, 121, 124
+};
+
+/**
+ * Procedural pattern that colours every LED from its position in a
+ * LedLayout. Position, distance and angle all come from the layout's
+ * tables, so a pixel is a couple of lookups and a multiply.
+ */
+class SpatialLedPattern : public GimpLedPattern
+{
+  public:
+    // wavesAcross is how many wave periods fit across the layout.
+    SpatialLedPattern(Adafruit_NeoPixel& strip, LedLayout& layout, SpatialEffect effect,
+                      uint32_t color, uint8_t wavesAcross, int frameDelay)
+      : GimpLedPattern(strip), mLayout(layout)
+    {
+      mEffect = effect;
+      mRed = (color >> 16) & 0xFF;
+      mGreen = (color >> 8) & 0xFF;
+      mBlue = color & 0xFF;
+      mWavesAcross = wavesAcross;
+      mFrameDelay = frameDelay;
+    }
+
+    ~SpatialLedPattern() {}
+
+    void playPattern()
+    {
+      for (int framePos = 0; framePos < SPATIAL_TOTAL_FRAMES; framePos++)
+      {
+        if (mInterrupt)
+        {
+          // If we are interrupted stop the pattern. "Clean" LED pattern.
+          mStrip.clear();
+          mStrip.show();
+          mInterrupt = false;
+          return;
+        }
+        renderFrame(framePos);
+        mStrip.show();
+        delay(mFrameDelay);
+      }
+    }
+
+    void stopPattern()
+    {
+      mInterrupt = true;
+    }
+
+    int getTotalFrames()
+    {
+      return SPATIAL_TOTAL_FRAMES;
+    }
+
+    int getFrameDelay()
+    {
+      return mFrameDelay;
+    }
+
+    void renderFrame(int framePos)
+    {
+      // The wave moves away from the origin as the phase goes up.
+      uint8_t phase = framePos * (256 / SPATIAL_TOTAL_FRAMES);
+      uint16_t ledCount = mLayout.getCount() < mStrip.numPixels() ? mLayout.getCount() : mStrip.numPixels();
+
+      for (uint16_t ledPos = 0; ledPos < ledCount; ledPos++)
+      {
+        uint8_t level = pgm_read_byte(&(SPATIAL_WAVE_LUT[(uint8_t)(getCoordinate(ledPos) * mWavesAcross - phase)]));
+        mStrip.setPixelColor(ledPos, (mRed * level) >> 8, (mGreen * level) >> 8, (mBlue * level) >> 8);
+      }
+    }
+
+  protected:
+    LedLayout& mLayout;
+    SpatialEffect mEffect;
+    uint8_t mRed;
+    uint8_t mGreen;
+    uint8_t mBlue;
+    uint8_t mWavesAcross;
+    int mFrameDelay;
+
+    uint8_t getCoordinate(uint16_t ledPos)
+    {
+      switch (mEffect)
+      {
+        case SPATIAL_WAVE_Y:
+          return mLayout.getY(ledPos);
+        case SPATIAL_RADIAL:
+          return mLayout.getDistance(ledPos);
+        case SPATIAL_SWEEP:
+          return mLayout.getAngle(ledPos);
+        default:
+          return mLayout.getX(ledPos);
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef STRIP_OUTPUT_H
+#define STRIP_OUTPUT_H
+#include <Adafruit_NeoPixel.h>
+#include "WaveformCache.h"
+
+// WS2812 latch time between two frames.
+#define STRIP_LATCH_US 300
+
+/**
+ * Sends the strip buffer out. On the nRF52 the PWM waveform of a pattern
+ * frame comes from the WaveformCache and is played straight from it,
+ * instead of the NeoPixel library encoding every bit again on every
+ * show(). Assumes an 800KHz RGB strip. Anywhere else, for frames that
+ * can't be cached, or when no PWM is free, it falls back to
+ * Adafruit_NeoPixel::show().
+ */
+class StripOutput
+{
+  public:
+    StripOutput(Adafruit_NeoPixel& strip): mStrip(strip), mCache(strip) {}
+
+    ~StripOutput() {}
+
+    void setCacheEnabled(bool enabled)
+    {
+      mCacheEnabled = enabled;
+    }
+
+    WaveformCache& getCache()
+    {
+      return mCache;
+    }
+
+    // Pass the pattern and frame when the strip buffer holds that frame
+    // exactly as rendered, NULL for anything else (fades, transitions).
+    void show(GimpLedPattern * pattern, int framePos)
+    {
+#if defined(ARDUINO_ARCH_NRF52)
+      if (mCacheEnabled && pattern != NULL)
+      {
+        const uint16_t * waveform = mCache.lookup(pattern, framePos);
+        if (waveform != NULL && playWaveform(waveform, WaveformCache::getWaveformWords(mStrip.numPixels() * 3)))
+        {
+          return;
+        }
+      }
+
+      // The library only waits out the latch of a frame it sent itself.
+      waitForLatch();
+      mStrip.show();
+      mLastEnd = micros();
+#else
+      (void) pattern;
+      (void) framePos;
+      mStrip.show();
+#endif
+    }
+
+  private:
+    Adafruit_NeoPixel& mStrip;
+    WaveformCache mCache;
+    bool mCacheEnabled = true;
+
+#if defined(ARDUINO_ARCH_NRF52)
+    // End of the last frame sent, by either path.
+    uint32_t mLastEnd = 0;
+
+    void waitForLatch()
+    {
+      while (!mStrip.canShow() || (micros() - mLastEnd) < STRIP_LATCH_US)
+      {
+        yield();
+      }
+    }
+
+    // Same sequence as the NeoPixel library's nRF52 path, minus the encoding.
+    bool playWaveform(const uint16_t * waveform, uint16_t words)
+    {
+      NRF_PWM_Type * pwms[] = {
+        NRF_PWM0, NRF_PWM1, NRF_PWM2
+#if defined(NRF_PWM3)
+        , NRF_PWM3
+#endif
+      };
+
+      // A PWM nobody else (analogWrite, tone) has claimed.
+      NRF_PWM_Type * pwm = NULL;
+      for (uint8_t i = 0; i < sizeof(pwms) / sizeof(pwms[0]); i++)
+      {
+        NRF_PWM_Type * candidate = pwms[i];
+        if (candidate->ENABLE == 0 &&
+            (candidate->PSEL.OUT[0] & PWM_PSEL_OUT_CONNECT_Msk) && (candidate->PSEL.OUT[1] & PWM_PSEL_OUT_CONNECT_Msk) &&
+            (candidate->PSEL.OUT[2] & PWM_PSEL_OUT_CONNECT_Msk) && (candidate->PSEL.OUT[3] & PWM_PSEL_OUT_CONNECT_Msk))
+        {
+          pwm = candidate;
+          break;
+        }
+      }
+      if (pwm == NULL)
+      {
+        return false;
+      }
+
+      waitForLatch();
+
+      pwm->MODE = (PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos);
+      pwm->PRESCALER = (PWM_PRESCALER_PRESCALER_DIV_1 << PWM_PRESCALER_PRESCALER_Pos);
+      pwm->COUNTERTOP = (WS2812_PWM_TOP << PWM_COUNTERTOP_COUNTERTOP_Pos);
+      pwm->LOOP = (PWM_LOOP_CNT_Disabled << PWM_LOOP_CNT_Pos);
+      pwm->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) | (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+      pwm->SEQ[0].PTR = (uint32_t)waveform << PWM_SEQ_PTR_PTR_Pos;
+      pwm->SEQ[0].CNT = words << PWM_SEQ_CNT_CNT_Pos;
+      pwm->SEQ[0].REFRESH = 0;
+      pwm->SEQ[0].ENDDELAY = 0;
+      pwm->PSEL.OUT[0] = g_ADigitalPinMap[mStrip.getPin()];
+
+      pwm->ENABLE = 1;
+      pwm->EVENTS_SEQEND[0] = 0;
+      pwm->TASKS_SEQSTART[0] = 1;
+      // The PWM reads the waveform by DMA, other tasks run meanwhile.
+      while (!pwm->EVENTS_SEQEND[0])
+      {
+        yield();
+      }
+      pwm->EVENTS_SEQEND[0] = 0;
+      pwm->ENABLE = 0;
+      pwm->PSEL.OUT[0] = 0xFFFFFFFFUL;
+
+      mLastEnd = micros();
+      return true;
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SYNC_TRANSPORT_H
+#define SYNC_TRANSPORT_H
+#include <stdint.h>
+
+#define SYNC_MESSAGE_MAX_LEN 16
+
+struct SyncMessage
+{
+  uint32_t receivedAt; // local millis() when the message arrived
+  uint8_t len;
+  uint8_t data[SYNC_MESSAGE_MAX_LEN];
+};
+
+/**
+ * Link used by PlaybackSync to exchange timebase and start messages.
+ * Kept free of any BLE types so the sync logic can run against a
+ * simulated link.
+ */
+class SyncTransport
+{
+  public:
+    virtual ~SyncTransport() {}
+
+    virtual bool send(const uint8_t * data, uint8_t len) = 0;
+
+    // Non-blocking, returns false when nothing is waiting.
+    virtual bool receive(SyncMessage& message) = 0;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef WAVEFORM_CACHE_H
+#define WAVEFORM_CACHE_H
+#include <Adafruit_NeoPixel.h>
+#include "GimpLedPattern.h"
+
+// RAM for encoded frames, 16 bytes per colour byte of a frame.
+#ifndef WAVEFORM_CACHE_MAX_BYTES
+#define WAVEFORM_CACHE_MAX_BYTES 8192
+#endif
+#define WAVEFORM_CACHE_MAX_SLOTS 32
+
+// WS2812 at 800KHz on the nRF52 PWM at 16MHz: 20 ticks = 1.25us per bit,
+// high for 0.375us (0) or 0.8125us (1). Bit 15 sets the output polarity.
+#define WS2812_PWM_TOP 20
+#define WS2812_PWM_T0H (6 | 0x8000)
+#define WS2812_PWM_T1H (13 | 0x8000)
+// Low words sent after the last bit so the line ends low.
+#define WS2812_PWM_END_WORDS 2
+
+/**
+ * Keeps the PWM duty cycle sequence of every frame of the active pattern,
+ * encoded from the strip buffer the first time the frame is shown, so a
+ * looping pattern only encodes each frame once. Frames are found by their
+ * position in the pattern, the caller only asks for frames that are in the
+ * strip buffer as rendered (full level, no transition). Patterns with more
+ * frames than fit are not cached at all, a least recently used scheme
+ * would only thrash on a loop. Reset when the pattern, its colours or the
+ * strip brightness change.
+ */
+class WaveformCache
+{
+  public:
+    WaveformCache(Adafruit_NeoPixel& strip): mStrip(strip) {}
+
+    ~WaveformCache() {}
+
+    static uint16_t getWaveformWords(uint16_t numBytes)
+    {
+      return numBytes * 8 + WS2812_PWM_END_WORDS;
+    }
+
+    // One duty cycle word per bit, most significant bit first, in the
+    // byte order of the strip buffer.
+    static void encode(const uint8_t * pixels, uint16_t numBytes, uint16_t * waveform)
+    {
+      for (uint16_t i = 0; i < numBytes; i++)
+      {
+        uint8_t value = pixels[i];
+        for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
+        {
+          *waveform++ = (value & mask) ? WS2812_PWM_T1H : WS2812_PWM_T0H;
+        }
+      }
+      for (uint8_t i = 0; i < WS2812_PWM_END_WORDS; i++)
+      {
+        *waveform++ = 0x8000;
+      }
+    }
+
+    // Waveform of the frame in the strip buffer, encoded on its first
+    // show. NULL when the pattern can't be cached, the caller then sends
+    // the strip buffer normally.
+    const uint16_t * lookup(GimpLedPattern * pattern, int framePos)
+    {
+      uint16_t numBytes = mStrip.numPixels() * 3;
+      if (pattern != mPattern || numBytes != mNumBytes || mStrip.getBrightness() != mBrightness ||
+          getRevision(pattern) != mRevision)
+      {
+        reset(pattern, numBytes);
+      }
+
+      if (!mValid || framePos < 0 || framePos >= mFrameCount)
+      {
+        return NULL;
+      }
+
+      uint16_t * waveform = getWaveform(framePos);
+      uint32_t bit = 1UL << framePos;
+      if (mEncoded & bit)
+      {
+        mHits++;
+      }
+      else
+      {
+        encode(mStrip.getPixels(), numBytes, waveform);
+        mEncoded |= bit;
+        mMisses++;
+      }
+      return waveform;
+    }
+
+    // Frames of the active pattern there is room for.
+    uint8_t getSlotCount()
+    {
+      return mSlotCount;
+    }
+
+    uint32_t getHits()
+    {
+      return mHits;
+    }
+
+    uint32_t getMisses()
+    {
+      return mMisses;
+    }
+
+  private:
+    Adafruit_NeoPixel& mStrip;
+    GimpLedPattern * mPattern = NULL;
+    uint8_t mBrightness = 0;
+    uint16_t mRevision = 0;
+    uint16_t mNumBytes = 0;
+    bool mValid = false;
+    uint8_t mSlotCount = 0;
+    int mFrameCount = 0;
+    uint32_t mEncoded = 0; // one bit per frame
+    uint32_t mHits = 0;
+    uint32_t mMisses = 0;
+    // Word aligned for the PWM's EasyDMA.
+    uint32_t mPool[WAVEFORM_CACHE_MAX_BYTES / 4];
+
+    void reset(GimpLedPattern * pattern, uint16_t numBytes)
+    {
+      mPattern = pattern;
+      mNumBytes = numBytes;
+      mBrightness = mStrip.getBrightness();
+      mRevision = getRevision(pattern);
+      mEncoded = 0;
+
+      uint32_t slots = (WAVEFORM_CACHE_MAX_BYTES / 2) / getWaveformWords(numBytes);
+      mSlotCount = slots > WAVEFORM_CACHE_MAX_SLOTS ? WAVEFORM_CACHE_MAX_SLOTS : slots;
+      mFrameCount = pattern != NULL ? pattern->getTotalFrames() : 0;
+      mValid = pattern != NULL && mFrameCount <= mSlotCount;
+    }
+
+    uint16_t * getWaveform(int framePos)
+    {
+      // Waveforms are always an even number of words.
+      return (uint16_t *)(mPool + framePos * (getWaveformWords(mNumBytes) / 2));
+    }
+
+    static uint16_t getRevision(GimpLedPattern * pattern)
+    {
+      ColorLut * colors = pattern != NULL ? pattern->getColorLut() : NULL;
+      return colors != NULL ? colors->getRevision() : 0;
+    }
+};
+
+#endif
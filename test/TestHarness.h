@@ -0,0 +1,49 @@
+#ifndef TEST_HARNESS_H
+#define TEST_HARNESS_H
+/****
+ * Shared by the host tests and benchmarks in test/, see run_tests.sh.
+ * CHECK() counts a failure and prints it, testResult() prints the verdict
+ * and gives the exit code for main(). nsPerCall() times a benchmark body.
+ ****/
+#include <stdio.h>
+#include <chrono>
+
+static int failures = 0;
+
+#define CHECK(condition, ...)                                   \
+  do                                                            \
+  {                                                             \
+    if (!(condition))                                           \
+    {                                                           \
+      failures++;                                               \
+      printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #condition); \
+      printf(__VA_ARGS__);                                      \
+      printf("\n");                                             \
+    }                                                           \
+  } while (0)
+
+static int testResult()
+{
+  printf(failures == 0 ? "PASS\n" : "%d FAILED\n", failures);
+  return failures == 0 ? 0 : 1;
+}
+
+// Average wall time of call(i) for i = 0 .. calls - 1, best of three
+// runs so a scheduler hiccup doesn't end up in the numbers.
+template <typename F> static double nsPerCall(F call, long calls)
+{
+  double best = 0;
+  for (int run = 0; run < 3; run++)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < calls; i++)
+    {
+      call(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    best = run == 0 || ns < best ? ns : best;
+  }
+  return best;
+}
+
+#endif
@@ -0,0 +1,117 @@
+/****
+ * Per-frame cost of showing a pattern through FrameCache against
+ * rendering it through setPixelColor(), at 20 and 500 LEDs, plus the
+ * cost of a rebuild after a pattern switch. Every cached frame is also
+ * checked against the rendered one.
+ *
+ * The cache is sized here to hold 500 LEDs x 8 frames; with the default
+ * FRAME_CACHE_MAX_BYTES the 500 LED strip takes the render path.
+ *
+ * Run: test/run_tests.sh bench
+ ****/
+
+#define FRAME_CACHE_MAX_BYTES (500 * 3 * 8)
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <vector>
+#include "FrameCache.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+#define TABLE_FRAMES 8
+
+/**
+ * A full frame table the way the GIMP plug-in writes it, every LED of
+ * every frame through setPixelColor().
+ */
+class TablePattern : public GimpLedPattern
+{
+  public:
+    TablePattern(Adafruit_NeoPixel& strip): GimpLedPattern(strip), mTable(strip.numPixels() * TABLE_FRAMES)
+    {
+      for (size_t i = 0; i < mTable.size(); i++)
+      {
+        mTable[i] = rand() & 0xFFFFFF;
+      }
+    }
+
+    void playPattern() {}
+    void stopPattern() {}
+
+    int getTotalFrames()
+    {
+      return TABLE_FRAMES;
+    }
+
+    void renderFrame(int framePos)
+    {
+      uint16_t numPixels = mStrip.numPixels();
+      const uint32_t * frame = &mTable[framePos * numPixels];
+      for (uint16_t ledPos = 0; ledPos < numPixels; ledPos++)
+      {
+        uint32_t ledColor = frame[ledPos];
+        mStrip.setPixelColor(ledPos, (ledColor >> 16) & 0xFF, (ledColor >> 8) & 0xFF, ledColor & 0xFF);
+      }
+    }
+
+  private:
+    std::vector<uint32_t> mTable;
+};
+
+static volatile uint8_t sink;
+
+static void bench(const char * name, Adafruit_NeoPixel& strip, GimpLedPattern& pattern, long calls)
+{
+  int totalFrames = pattern.getTotalFrames();
+  uint16_t numBytes = strip.numPixels() * 3;
+  uint8_t * pixels = strip.getPixels();
+  FrameCache cache(strip);
+
+  // Same bytes either way.
+  std::vector<uint8_t> rendered(numBytes);
+  int wrong = 0;
+  for (int framePos = 0; framePos < totalFrames; framePos++)
+  {
+    pattern.invalidateFrame();
+    pattern.renderFrame(framePos);
+    rendered.assign(pixels, pixels + numBytes);
+    CHECK(cache.blit(&pattern, framePos), "%s not cached", name);
+    wrong += memcmp(pixels, rendered.data(), numBytes) != 0;
+  }
+  CHECK(wrong == 0, "%s: %d cached frames differ from the rendered ones", name, wrong);
+
+  pattern.invalidateFrame();
+  double render = nsPerCall([&](long i) {
+    pattern.renderFrame(i % totalFrames);
+    sink = pixels[i % numBytes];
+  }, calls);
+  double blit = nsPerCall([&](long i) {
+    cache.blit(&pattern, i % totalFrames);
+    sink = pixels[i % numBytes];
+  }, calls);
+  double rebuild = nsPerCall([&](long i) {
+    cache.invalidate();
+    cache.blit(&pattern, i % totalFrames);
+    sink = pixels[i % numBytes];
+  }, calls / 50);
+  printf("%-22s %3u LEDs: render %8.1f ns/frame, blit %6.1f ns/frame, rebuild %9.1f ns\n", name,
+         strip.numPixels(), render, blit, rebuild);
+}
+
+int main()
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  strip.setBrightness(128);
+  Pattern_ELEMENT fire(strip, 0xff0000);
+  bench("Pattern_ELEMENT", strip, fire, 5000000);
+  TablePattern table(strip);
+  bench("frame table", strip, table, 5000000);
+
+  Adafruit_NeoPixel longStrip(500, 7, NEO_GRB + NEO_KHZ800);
+  longStrip.setBrightness(128);
+  TablePattern longTable(longStrip);
+  bench("frame table", longStrip, longTable, 200000);
+
+  return testResult();
+}
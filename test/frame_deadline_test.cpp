@@ -0,0 +1,111 @@
+/****
+ * Load injection for PatternPlayer's frame deadlines: the loop is stalled
+ * at random, up to several seconds, and after every update() the frame on
+ * the strip has to be the one due at that time, with every frame passed
+ * over counted as dropped.
+ *
+ * Build: g++ -std=gnu++11 -Wall -I tools/hoststubs -I . test/frame_deadline_test.cpp
+ ****/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "PatternPlayer.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+// Plays for durationMs with random stalls of up to maxStallMs and checks
+// the frame phase on every update.
+static void runStalls(uint16_t rate, uint32_t maxStallMs, uint32_t durationMs, unsigned seed)
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT pattern(strip);
+  PatternPlayer player(strip);
+  player.setRate(rate);
+  player.play(&pattern);
+  player.update(0);
+
+  srand(seed);
+  uint32_t frameTicks = ELEMENT_DELAY * PLAYER_RATE_ONE;
+  uint32_t lastIndex = 0;
+  uint32_t expectedDropped = 0;
+  int outOfPhase = 0;
+  for (uint32_t now = 0; now < durationMs;)
+  {
+    now += (rand() % 50 == 0) ? 1 + rand() % maxStallMs : 1 + rand() % 3;
+    player.update(now);
+
+    uint32_t index = ((uint64_t)now * rate) / frameTicks;
+    if (player.getFramePos() != (int)(index % ELEMENT_TOTAL_FRAMES))
+    {
+      outOfPhase++;
+    }
+    if (index > lastIndex + 1)
+    {
+      expectedDropped += index - lastIndex - 1;
+    }
+    if (index != lastIndex)
+    {
+      lastIndex = index;
+    }
+  }
+
+  const FrameTimingStats& stats = player.getDeadlineMonitor().getStats();
+  printf("rate %u, stalls up to %u ms: shown %u, dropped %u, late %u, max overrun %u ms\n",
+         rate, maxStallMs, stats.framesShown, stats.framesDropped, stats.framesLate, stats.maxOverrunMs);
+  CHECK(outOfPhase == 0, "%d updates out of phase", outOfPhase);
+  CHECK(stats.framesDropped == expectedDropped, "dropped %u, expected %u", stats.framesDropped, expectedDropped);
+  CHECK(stats.framesShown + stats.framesDropped == lastIndex + 1, "shown + dropped %u, expected %u",
+        stats.framesShown + stats.framesDropped, lastIndex + 1);
+}
+
+// A stall past the end of a limited pattern holds its last frame.
+static void runLoopLimit()
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT pattern(strip);
+  PatternPlayer player(strip);
+  player.play(&pattern, 3);
+  player.update(0);
+  player.update(100000);
+
+  CHECK(player.isFinished(), "not finished after a 100 s stall");
+  CHECK(player.getLoopCount() == 3, "loop count %u", player.getLoopCount());
+  CHECK(player.getFramePos() == ELEMENT_TOTAL_FRAMES - 1, "holding frame %d", player.getFramePos());
+}
+
+// The show clock stepping onto a sync timebase moves neither the frame
+// nor the drop count.
+static void runTimebaseStep()
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT pattern(strip);
+  PatternPlayer player(strip);
+  player.play(&pattern);
+  for (uint32_t now = 0; now <= 1050; now++)
+  {
+    player.update(now);
+  }
+  int framePos = player.getFramePos();
+
+  int32_t step = 3600000;
+  player.shiftTime(step);
+  player.update(1051 + step);
+  CHECK(player.getFramePos() == framePos, "frame %d after the step, was %d", player.getFramePos(), framePos);
+  player.update(1200 + step);
+  CHECK(player.getFramePos() == framePos + 1, "frame %d, expected %d", player.getFramePos(), framePos + 1);
+  CHECK(player.getDeadlineMonitor().getStats().framesDropped == 0, "dropped %u",
+        player.getDeadlineMonitor().getStats().framesDropped);
+}
+
+int main()
+{
+  runStalls(PLAYER_RATE_ONE, 700, 600000, 1);
+  runStalls(PLAYER_RATE_ONE, 1500, 600000, 2);
+  runStalls(PLAYER_RATE_ONE, 10000, 600000, 3);
+  runStalls(PLAYER_RATE_ONE * 3, 1500, 600000, 4);
+  runStalls(PLAYER_RATE_MIN, 1500, 600000, 5);
+  runLoopLimit();
+  runTimebaseStep();
+
+  return testResult();
+}
@@ -0,0 +1,165 @@
+/****
+ * PatternSequencer playlists against their ideal schedule: every entry
+ * starts when the one before it was due to end, however late loop()
+ * noticed. After every update the player has to be on the entry and
+ * frame the schedule has for that time, through random loop latency,
+ * stalls across entry boundaries and a timebase step during a fade.
+ *
+ * Build: g++ -std=gnu++11 -Wall -I tools/hoststubs -I . test/pattern_sequencer_test.cpp
+ ****/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "PatternPlayer.h"
+#include "PatternSequencer.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+#define PATTERN_COUNT 6
+#define LOOP_MS (ELEMENT_TOTAL_FRAMES * ELEMENT_DELAY)
+// Shows this close after an entry starts may still be the outgoing
+// frame, a transition at progress 0 isn't shown.
+#define TRANSITION_GRACE_MS 5
+
+static GimpLedPattern * patterns[PATTERN_COUNT];
+
+static GimpLedPattern * lookup(uint8_t patternId)
+{
+  return patternId < PATTERN_COUNT ? patterns[patternId] : NULL;
+}
+
+static int getPatternId(GimpLedPattern * pattern)
+{
+  for (int i = 1; i < PATTERN_COUNT; i++)
+  {
+    if (patterns[i] == pattern)
+    {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static int finishedCount = 0;
+static uint8_t finishedTag = 0;
+
+static void finished(uint8_t tag)
+{
+  finishedCount++;
+  finishedTag = tag;
+}
+
+struct Scheduled
+{
+  uint8_t patternId;
+  uint32_t start;    // first frame
+  uint32_t end;      // next entry takes over
+  bool transition;   // crossfade or wipe into this entry
+};
+
+// fire 2 loops (cut), water 1.3 s (crossfade 300), thunder 1 loop (fade
+// 400: water plays on while fading out for 200), ice 1 s (wipe 200),
+// dragon 1 loop (cut), then off.
+static const uint8_t PLAYLIST[] = {
+  1, SEQ_END_REPEAT | (SEQ_TRANSITION_CUT << 4), 2, 0, 0,
+  2, SEQ_END_DURATION | (SEQ_TRANSITION_CROSSFADE << 4), 130, 0, 30,
+  3, SEQ_END_REPEAT | (SEQ_TRANSITION_FADE << 4), 1, 0, 40,
+  4, SEQ_END_DURATION | (SEQ_TRANSITION_WIPE << 4), 100, 0, 20,
+  5, SEQ_END_REPEAT | (SEQ_TRANSITION_CUT << 4), 1, 0, 0
+};
+
+static const Scheduled SCHEDULE[] = {
+  { 1, 0, 2 * LOOP_MS, false },
+  { 2, 3200, 4700, true },   // ends 4500, plays on through the fade out
+  { 3, 4700, 6300, false },
+  { 4, 6300, 7300, true },
+  { 5, 7300, 8900, false }
+};
+#define SCHEDULE_COUNT (sizeof(SCHEDULE) / sizeof(SCHEDULE[0]))
+#define PLAYLIST_END 8900
+
+// Runs the playlist with loop() latencies of up to maxStepMs and stalls
+// of up to maxStallMs, counting updates where the player is off schedule.
+static void runPlaylist(uint32_t maxStepMs, uint32_t maxStallMs, unsigned seed)
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT fire(strip, 0xff0000);
+  Pattern_ELEMENT water(strip, 0x006cfb);
+  Pattern_ELEMENT thunder(strip, 0xffe600);
+  Pattern_ELEMENT ice(strip, 0x00cee0);
+  Pattern_ELEMENT dragon(strip, 0xec13f8);
+  patterns[0] = NULL;
+  patterns[1] = &fire;
+  patterns[2] = &water;
+  patterns[3] = &thunder;
+  patterns[4] = &ice;
+  patterns[5] = &dragon;
+
+  PatternPlayer player(strip);
+  PatternSequencer sequencer(player, lookup, finished);
+  finishedCount = 0;
+
+  srand(seed);
+  // The show clock steps once, in the middle of the fade out.
+  const uint32_t stepAt = 4600;
+  const int32_t step = 100000;
+  int32_t offset = 0;
+
+  int offSchedule = 0;
+  int checks = 0;
+  CHECK(sequencer.load(PLAYLIST, sizeof(PLAYLIST), 42), "playlist rejected");
+  for (uint32_t now = 0; now < PLAYLIST_END + 500;)
+  {
+    if (now >= stepAt && offset == 0)
+    {
+      offset = step;
+      player.shiftTime(step);
+      sequencer.shiftTime(step);
+    }
+
+    sequencer.update(now + offset);
+    player.update(now + offset);
+
+    for (uint8_t i = 0; i < SCHEDULE_COUNT; i++)
+    {
+      const Scheduled& entry = SCHEDULE[i];
+      if (now < entry.start || now >= entry.end)
+      {
+        continue;
+      }
+      if (entry.transition && now < entry.start + TRANSITION_GRACE_MS)
+      {
+        break;
+      }
+      checks++;
+      int framePos = ((now - entry.start) / ELEMENT_DELAY) % ELEMENT_TOTAL_FRAMES;
+      if (player.getPattern() != patterns[entry.patternId] || player.getFramePos() != framePos)
+      {
+        if (offSchedule < 5)
+        {
+          printf("  at %u: expected pattern %u frame %d, playing pattern %d frame %d\n", now, entry.patternId,
+                 framePos, getPatternId(player.getPattern()), player.getFramePos());
+        }
+        offSchedule++;
+      }
+    }
+
+    now += (rand() % 100 == 0) ? 1 + rand() % maxStallMs : 1 + rand() % maxStepMs;
+  }
+
+  printf("steps up to %u ms, stalls up to %u ms: %d of %d updates off schedule\n", maxStepMs, maxStallMs,
+         offSchedule, checks);
+  CHECK(offSchedule == 0, "%d updates off schedule", offSchedule);
+  CHECK(finishedCount == 1 && finishedTag == 42, "finished %d times, tag %u", finishedCount, finishedTag);
+  CHECK(player.getPattern() == NULL, "still playing after the playlist");
+  CHECK(!sequencer.isRunning(), "sequencer still running");
+}
+
+int main()
+{
+  runPlaylist(1, 1, 1);
+  runPlaylist(3, 60, 2);
+  runPlaylist(7, 250, 3);
+
+  return testResult();
+}
@@ -0,0 +1,223 @@
+/****
+ * Pattern switches through PatternTransition, checked on what reaches
+ * the strip: a crossfade shows colours between the outgoing and incoming
+ * frame, a wipe sweeps along the layout x axis, no switch goes through
+ * black, and no show sends the same bytes as the one before it.
+ *
+ * Build: g++ -std=gnu++11 -Wall -I tools/hoststubs -I . test/pattern_transition_test.cpp
+ ****/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <vector>
+#include "PatternPlayer.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+#define NUM_BYTES (ELEMENT_TOTAL_LEDS * 3)
+#define TRANSITION_MS 300
+#define WIPE_MS 500
+
+// Shorter than the strip, and against strip order: the last LEDs go by
+// their index.
+#define WIPE_LAYOUT_COUNT 12
+const LedPoint WIPE_LAYOUT[WIPE_LAYOUT_COUNT] PROGMEM = {
+  {143, 0}, {130, 0}, {117, 0}, {104, 0}, {91, 0}, {78, 0},
+  {65, 0}, {52, 0}, {39, 0}, {26, 0}, {13, 0}, {0, 0}
+};
+
+struct Show
+{
+  uint32_t time;
+  std::vector<uint8_t> pixels;
+};
+
+static std::vector<Show> shows;
+static uint32_t now = 0;
+
+static void recordShow(Adafruit_NeoPixel& strip)
+{
+  Show show;
+  show.time = now;
+  show.pixels.assign(strip.getPixels(), strip.getPixels() + NUM_BYTES);
+  shows.push_back(show);
+}
+
+// With a reference (the incoming pattern, rendering to referenceStrip)
+// the frame the player is on is rendered again after each show.
+static Adafruit_NeoPixel referenceStrip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+static std::vector<std::vector<uint8_t>> incoming;
+
+static void run(PatternPlayer& player, uint32_t durationMs, GimpLedPattern * reference = NULL)
+{
+  for (uint32_t end = now + durationMs; now < end; now++)
+  {
+    size_t before = shows.size();
+    player.update(now);
+    if (shows.size() > before && reference != NULL)
+    {
+      reference->invalidateFrame();
+      reference->renderFrame(player.getFramePos());
+      const uint8_t * pixels = referenceStrip.getPixels();
+      incoming.resize(shows.size());
+      incoming.back().assign(pixels, pixels + NUM_BYTES);
+    }
+  }
+}
+
+static bool isBlack(const std::vector<uint8_t>& pixels)
+{
+  for (size_t i = 0; i < pixels.size(); i++)
+  {
+    if (pixels[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t countBlack(size_t from, size_t to)
+{
+  size_t black = 0;
+  for (size_t i = from; i < to; i++)
+  {
+    black += isBlack(shows[i].pixels);
+  }
+  return black;
+}
+
+// Every byte shown during the crossfade lies between the outgoing frame
+// and the incoming one, and most shows are a real mix of both.
+static void checkCrossfade(const std::vector<uint8_t>& outgoing, size_t first, uint32_t switchTime)
+{
+  int outside = 0;
+  int blended = 0;
+  int during = 0;
+  for (size_t i = first; i < shows.size() && shows[i].time < switchTime + TRANSITION_MS; i++)
+  {
+    during++;
+    bool mixed = false;
+    for (int b = 0; b < NUM_BYTES; b++)
+    {
+      uint8_t from = outgoing[b];
+      uint8_t to = incoming[i][b];
+      uint8_t value = shows[i].pixels[b];
+      if (value < (from < to ? from : to) || value > (from > to ? from : to))
+      {
+        outside++;
+      }
+      if (value != from && value != to)
+      {
+        mixed = true;
+      }
+    }
+    blended += mixed;
+  }
+  printf("crossfade: %d shows, %d blended\n", during, blended);
+  CHECK(outside == 0, "%d bytes outside the outgoing and incoming colours", outside);
+  CHECK(blended >= TRANSITION_MS / PLAYER_FADE_FRAME_MS / 2, "only %d of %d shows blended", blended, during);
+}
+
+// The LEDs the wipe has reached are always the ones lowest on the layout
+// x axis, and that set only grows, a few LEDs at a time.
+static void checkWipe(const std::vector<uint8_t>& outgoing, size_t first, uint32_t switchTime)
+{
+  int position[ELEMENT_TOTAL_LEDS];
+  for (int i = 0; i < ELEMENT_TOTAL_LEDS; i++)
+  {
+    position[i] = i < WIPE_LAYOUT_COUNT ? pgm_read_byte(&WIPE_LAYOUT[i].x) : (i * 256) / ELEMENT_TOTAL_LEDS;
+  }
+
+  int notPrefix = 0;
+  int backwards = 0;
+  int lastReached = 0;
+  int steps = 0;
+  for (size_t i = first; i < shows.size() && shows[i].time <= switchTime + WIPE_MS; i++)
+  {
+    int reached = 0;
+    int highestReached = -1;
+    int lowestUnreached = 256;
+    for (int led = 0; led < ELEMENT_TOTAL_LEDS; led++)
+    {
+      if (memcmp(&shows[i].pixels[led * 3], &outgoing[led * 3], 3) != 0)
+      {
+        reached++;
+        highestReached = position[led] > highestReached ? position[led] : highestReached;
+      }
+      else
+      {
+        lowestUnreached = position[led] < lowestUnreached ? position[led] : lowestUnreached;
+      }
+    }
+    notPrefix += highestReached > lowestUnreached;
+    backwards += reached < lastReached;
+    if (reached > lastReached && reached < ELEMENT_TOTAL_LEDS)
+    {
+      steps++;
+    }
+    lastReached = reached;
+  }
+  printf("wipe: reached LEDs grew in %d steps\n", steps);
+  CHECK(notPrefix == 0, "%d shows with the edge out of layout order", notPrefix);
+  CHECK(backwards == 0, "%d shows with the edge moving back", backwards);
+  CHECK(steps >= 5, "edge moved in %d steps", steps);
+  CHECK(lastReached == ELEMENT_TOTAL_LEDS, "wipe ended with %d LEDs reached", lastReached);
+}
+
+int main()
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  strip.setShowHook(recordShow);
+  Pattern_ELEMENT red(strip, 0xff0000);
+  Pattern_ELEMENT blue(strip, 0x0000ff);
+  LedLayout layout(WIPE_LAYOUT, WIPE_LAYOUT_COUNT);
+  layout.begin();
+  PatternPlayer player(strip);
+  player.setTransitionLayout(&layout);
+
+  player.play(&red);
+  run(player, 2000);
+
+  std::vector<uint8_t> outgoing = shows.back().pixels;
+  size_t first = shows.size();
+  uint32_t switchTime = now;
+  player.play(&blue, 0, TRANSITION_CROSSFADE, TRANSITION_MS);
+  Pattern_ELEMENT blueReference(referenceStrip, 0x0000ff);
+  run(player, 2000, &blueReference);
+  checkCrossfade(outgoing, first, switchTime);
+  CHECK(countBlack(first, shows.size()) == 0, "black frames in the crossfade");
+
+  outgoing = shows.back().pixels;
+  first = shows.size();
+  switchTime = now;
+  player.play(&red, 0, TRANSITION_WIPE, WIPE_MS);
+  run(player, 2000);
+  checkWipe(outgoing, first, switchTime);
+  CHECK(countBlack(first, shows.size()) == 0, "black frames in the wipe");
+
+  player.fadeTo(PLAYER_LEVEL_MAX / 4, 400, now);
+  run(player, 1000);
+  player.fadeTo(PLAYER_LEVEL_MAX, 400, now);
+  run(player, 1000);
+
+  // One loop, then the last frame is held for seconds.
+  player.play(&blue, 1, TRANSITION_CROSSFADE, TRANSITION_MS);
+  run(player, 5000);
+  CHECK(player.isFinished(), "one loop not finished");
+  CHECK(countBlack(0, shows.size()) == 0, "black frames while playing");
+
+  player.play(NULL, 0, TRANSITION_CROSSFADE, TRANSITION_MS);
+  run(player, 1000);
+  CHECK(isBlack(shows.back().pixels), "strip not dark after the fade out");
+
+  int repeats = 0;
+  for (size_t i = 1; i < shows.size(); i++)
+  {
+    repeats += shows[i].pixels == shows[i - 1].pixels;
+  }
+  printf("%u shows, %d repeated the strip\n", (unsigned)shows.size(), repeats);
+  CHECK(repeats == 0, "%d shows repeated the strip", repeats);
+
+  return testResult();
+}
@@ -0,0 +1,236 @@
+/****
+ * Several props on one simulated link: a leader broadcasts its timebase
+ * and a start time, followers with skewed clocks receive it with random
+ * latency and have to show the same frame as the leader. One follower
+ * only connects after the start time and hears the start message seconds
+ * before its first timebase, it has to keep playing what it was playing
+ * until then and not wait for a start time it can't place yet.
+ *
+ * Build: g++ -std=gnu++11 -Wall -I tools/hoststubs -I . test/playback_sync_test.cpp
+ ****/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <deque>
+#include "PatternPlayer.h"
+#include "PlaybackSync.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+#define DEVICE_COUNT 4 // leader first
+#define LATENCY_MIN_MS 5
+#define LATENCY_MAX_MS 105
+#define RUN_MS 180000
+#define START_AT_MS 3000   // leader time the pattern is started at
+#define SETTLE_MS 20000    // sync windows filled, errors are checked after this
+#define MAX_ERROR_MS 40
+#define MAX_WAITING_MS 600  // the leader starts 500 ms ahead
+
+struct Delivery
+{
+  double arriveAt; // true time
+  SyncMessage message;
+};
+
+struct Device;
+
+// Leader to followers, each message delayed on its own.
+class SimTransport : public SyncTransport
+{
+  public:
+    Device * device = NULL;
+    std::deque<Delivery> inbox;
+
+    bool send(const uint8_t * data, uint8_t len);
+    bool receive(SyncMessage& message);
+};
+
+struct Device
+{
+  const char * name;
+  double skewPpm;
+  double offsetMs;
+  double connectAt; // true time the link comes up
+  double timebaseAt; // true time the first timebase gets through
+  SimTransport transport;
+  Adafruit_NeoPixel strip;
+  Pattern_ELEMENT pattern;
+  PatternPlayer player;
+  PlaybackSync sync;
+  int32_t maxErrorMs;
+  uint32_t waitingMs;
+  uint32_t maxWaitingMs;
+  uint32_t misses;
+  uint32_t checks;
+
+  Device(const char * name, double skewPpm, double offsetMs, double connectAt, double timebaseAt,
+         sync_start_callback_t startCallback)
+    : name(name), skewPpm(skewPpm), offsetMs(offsetMs), connectAt(connectAt), timebaseAt(timebaseAt),
+      strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800), pattern(strip), player(strip),
+      sync(transport, startCallback), maxErrorMs(0), waitingMs(0), maxWaitingMs(0), misses(0), checks(0)
+  {
+    transport.device = this;
+  }
+
+  uint32_t localTime(double trueTime)
+  {
+    return (uint32_t)(trueTime * (1.0 + skewPpm / 1e6) + offsetMs);
+  }
+};
+
+static Device * devices[DEVICE_COUNT];
+static Device * current = NULL;
+static double trueNow = 0;
+
+bool SimTransport::send(const uint8_t * data, uint8_t len)
+{
+  for (int i = 0; i < DEVICE_COUNT; i++)
+  {
+    Device * to = devices[i];
+    if (to == device || trueNow < to->connectAt || (data[0] == SYNC_CMD_TIME && trueNow < to->timebaseAt))
+    {
+      continue;
+    }
+    Delivery delivery;
+    delivery.arriveAt = trueNow + LATENCY_MIN_MS + rand() % (LATENCY_MAX_MS - LATENCY_MIN_MS + 1);
+    delivery.message.len = len;
+    memcpy(delivery.message.data, data, len);
+    // Later messages can't overtake, like on one BLE connection.
+    if (!to->transport.inbox.empty() && to->transport.inbox.back().arriveAt > delivery.arriveAt)
+    {
+      delivery.arriveAt = to->transport.inbox.back().arriveAt;
+    }
+    to->transport.inbox.push_back(delivery);
+  }
+  return true;
+}
+
+bool SimTransport::receive(SyncMessage& message)
+{
+  if (inbox.empty() || inbox.front().arriveAt > trueNow)
+  {
+    return false;
+  }
+  message = inbox.front().message;
+  message.receivedAt = device->localTime(inbox.front().arriveAt);
+  inbox.pop_front();
+  return true;
+}
+
+static void startCallback(uint8_t patternId, uint32_t showTime)
+{
+  current->player.playAt(patternId != 0 ? &current->pattern : NULL, showTime);
+}
+
+static void step(Device * device, uint32_t leaderTime, bool check)
+{
+  current = device;
+  uint32_t now = device->localTime(trueNow);
+  device->sync.update(now);
+  int32_t timebaseStep = device->sync.getTimebaseStep();
+  if (timebaseStep != 0)
+  {
+    device->player.shiftTime(timebaseStep);
+  }
+  uint32_t showTime = device->sync.toShowTime(now);
+  device->player.update(showTime);
+
+  device->waitingMs = device->player.getState() == PLAYER_WAITING ? device->waitingMs + 1 : 0;
+  if (device->waitingMs > device->maxWaitingMs)
+  {
+    device->maxWaitingMs = device->waitingMs;
+  }
+
+  if (!check)
+  {
+    return;
+  }
+
+  int32_t error = (int32_t)(showTime - leaderTime);
+  if (abs(error) > device->maxErrorMs)
+  {
+    device->maxErrorMs = abs(error);
+  }
+
+  // The frame due on the leader's clock, unless the leader's time is too
+  // close to a frame change to tell.
+  uint32_t sinceStart = leaderTime - devices[0]->offsetMs - START_AT_MS;
+  uint32_t intoFrame = sinceStart % ELEMENT_DELAY;
+  if (intoFrame >= MAX_ERROR_MS && intoFrame < ELEMENT_DELAY - MAX_ERROR_MS)
+  {
+    device->checks++;
+    if (device->player.getFramePos() != (int)((sinceStart / ELEMENT_DELAY) % ELEMENT_TOTAL_FRAMES))
+    {
+      device->misses++;
+    }
+  }
+}
+
+int main()
+{
+  srand(1);
+  // The leader's clock is far ahead of the followers', so a start time
+  // taken on the follower's own clock would be hours away.
+  Device leader("leader", 0, 5000000, 0, 0, startCallback);
+  Device fast("fast", 500, 1000, 0, 0, startCallback);
+  Device slow("slow", -500, 250000, 0, 0, startCallback);
+  Device late("late joiner", 300, 40, 60000, 63000, startCallback);
+  devices[0] = &leader;
+  devices[1] = &fast;
+  devices[2] = &slow;
+  devices[3] = &late;
+  leader.sync.setLeader(true);
+  for (int i = 0; i < DEVICE_COUNT; i++)
+  {
+    // Whatever each prop was showing on its own.
+    devices[i]->player.play(&devices[i]->pattern);
+  }
+
+  uint32_t startTime = leader.offsetMs + START_AT_MS;
+  for (int ms = 0; ms < RUN_MS; ms++)
+  {
+    trueNow = ms;
+    uint32_t leaderTime = leader.localTime(trueNow);
+
+    if (leaderTime == startTime - 500)
+    {
+      // Started half a second ahead so every prop has it in time.
+      current = &leader;
+      leader.sync.startAt(1, startTime);
+    }
+    if (ms == (int)late.connectAt)
+    {
+      // The app repeats the start for the prop that just connected, ahead
+      // of the first timebase message it gets.
+      Delivery delivery;
+      delivery.arriveAt = trueNow;
+      delivery.message.len = 7;
+      delivery.message.data[0] = SYNC_CMD_START_AT;
+      delivery.message.data[1] = 0;
+      delivery.message.data[2] = 1;
+      for (int i = 0; i < 4; i++)
+      {
+        delivery.message.data[3 + i] = (startTime >> (8 * i)) & 0xFF;
+      }
+      late.transport.inbox.push_front(delivery);
+    }
+
+    for (int i = 0; i < DEVICE_COUNT; i++)
+    {
+      step(devices[i], leaderTime, ms >= devices[i]->connectAt + SETTLE_MS);
+    }
+  }
+
+  for (int i = 0; i < DEVICE_COUNT; i++)
+  {
+    Device * device = devices[i];
+    printf("%-12s skew %+5.0f ppm: max |show time error| %d ms, %u of %u frames wrong, waited %u ms\n",
+           device->name, device->skewPpm, device->maxErrorMs, device->misses, device->checks, device->maxWaitingMs);
+    CHECK(device->maxErrorMs <= MAX_ERROR_MS, "%s off by %d ms", device->name, device->maxErrorMs);
+    CHECK(device->misses == 0, "%s showed %u wrong frames", device->name, device->misses);
+    CHECK(device->maxWaitingMs <= MAX_WAITING_MS, "%s waited %u ms", device->name, device->maxWaitingMs);
+    CHECK(device->player.getState() == PLAYER_PLAYING, "%s in state %d", device->name, device->player.getState());
+  }
+
+  return testResult();
+}
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Builds every test/*_test.cpp against the host stubs in tools/hoststubs
+# and runs it. Run from anywhere, exits non-zero if any test fails. The
+# tests share CHECK() and testResult() from test/TestHarness.h.
+#
+# "run_tests.sh bench" builds the test/*_bench.cpp benchmarks at -O2
+# instead and prints their timings.
+cd "$(dirname "$0")/.." || exit 2
+CXX=${CXX:-g++}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+suffix=test
+optimize=-O1
+if [ "$1" = bench ]; then
+  suffix=bench
+  optimize=-O2
+fi
+
+status=0
+for source in test/*_$suffix.cpp; do
+  name=$(basename "$source" .cpp)
+  echo "== $name"
+  if ! $CXX -std=gnu++11 -Wall $optimize -I tools/hoststubs -I . "$source" -o "$OUT/$name"; then
+    status=1
+    continue
+  fi
+  "$OUT/$name" || status=1
+done
+exit $status
@@ -0,0 +1,93 @@
+/****
+ * CPU cost per show of the PWM waveform with the WaveformCache on and
+ * off, for the shipped design: one slot per frame of the active pattern,
+ * and no caching at all for strips too long to fit. Rendering the frame
+ * is the same either way and is left out.
+ *
+ *   off     encode() on every show, what the NeoPixel library does
+ *   hit     lookup() of a frame encoded on an earlier loop
+ *   miss    lookup() that encodes into its slot (first loop, switches)
+ *   bypass  lookup() on a strip that doesn't fit, then encode()
+ *
+ * Run: test/run_tests.sh bench
+ ****/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <vector>
+#include "WaveformCache.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+static volatile uint16_t sink;
+
+static void bench(uint16_t numPixels, long calls)
+{
+  Adafruit_NeoPixel strip(numPixels, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT red(strip, 0xff0000);
+  Pattern_ELEMENT blue(strip, 0x0000ff);
+  red.renderFrame(0);
+  uint16_t numBytes = numPixels * 3;
+  uint16_t words = WaveformCache::getWaveformWords(numBytes);
+  std::vector<uint16_t> waveform(words);
+  WaveformCache cache(strip);
+
+  double off = nsPerCall([&](long i) {
+    WaveformCache::encode(strip.getPixels(), numBytes, waveform.data());
+    sink = waveform[i % words];
+  }, calls);
+
+  const char * design;
+  double on;
+  double miss = 0;
+  bool cached = cache.lookup(&red, 0) != NULL;
+  if (cached)
+  {
+    design = "cached";
+    for (int framePos = 1; framePos < ELEMENT_TOTAL_FRAMES; framePos++)
+    {
+      cache.lookup(&red, framePos);
+    }
+    uint32_t misses = cache.getMisses();
+    on = nsPerCall([&](long i) {
+      sink = cache.lookup(&red, i % ELEMENT_TOTAL_FRAMES)[i % words];
+    }, calls);
+    CHECK(cache.getMisses() == misses, "%u misses while looping", cache.getMisses() - misses);
+
+    // A switch every loop, every lookup encodes.
+    miss = nsPerCall([&](long i) {
+      GimpLedPattern * pattern = (i / ELEMENT_TOTAL_FRAMES) % 2 ? &blue : &red;
+      sink = cache.lookup(pattern, i % ELEMENT_TOTAL_FRAMES)[i % words];
+    }, calls);
+  }
+  else
+  {
+    design = "bypass";
+    on = nsPerCall([&](long i) {
+      if (cache.lookup(&red, i % ELEMENT_TOTAL_FRAMES) == NULL)
+      {
+        WaveformCache::encode(strip.getPixels(), numBytes, waveform.data());
+      }
+      sink = waveform[i % words];
+    }, calls);
+    CHECK(cache.getMisses() == 0, "encoded %u frames that can't be kept", cache.getMisses());
+  }
+
+  // 1.25us per bit on the wire, the same with or without the cache.
+  printf("%3u LEDs, %2u slots, %-6s: off %7.1f ns, %s %7.1f ns", numPixels, cache.getSlotCount(), design, off,
+         cached ? "hit" : "on", on);
+  if (miss > 0)
+  {
+    printf(", miss %7.1f ns", miss);
+  }
+  printf(" per show, wire %u us\n", numBytes * 10);
+}
+
+int main()
+{
+  bench(ELEMENT_TOTAL_LEDS, 2000000);
+  bench(100, 500000);
+  bench(300, 200000);
+
+  return testResult();
+}
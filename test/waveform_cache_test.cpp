@@ -0,0 +1,144 @@
+/****
+ * WaveformCache against the encoding of the Adafruit NeoPixel library's
+ * nRF52 show(), and the cache hits of looping patterns.
+ *
+ * Build: g++ -std=gnu++11 -Wall -I tools/hoststubs -I . test/waveform_cache_test.cpp
+ ****/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <vector>
+#include "WaveformCache.h"
+#include "Pattern_ELEMENT.h"
+#include "TestHarness.h"
+
+// What Adafruit_NeoPixel::show() builds for an 800KHz strip on the
+// nRF52, written out the way the library does it.
+#define MAGIC_T0H 6UL | (0x8000)
+#define MAGIC_T1H 13UL | (0x8000)
+#define CTOPVAL 20UL
+
+static std::vector<uint16_t> referenceEncode(const uint8_t * pixels, uint16_t numBytes)
+{
+  std::vector<uint16_t> pattern;
+  for (uint16_t n = 0; n < numBytes; n++)
+  {
+    uint8_t pix = pixels[n];
+    for (uint8_t mask = 0x80; mask > 0; mask >>= 1)
+    {
+      pattern.push_back((pix & mask) ? MAGIC_T1H : MAGIC_T0H);
+    }
+  }
+  pattern.push_back(0 | (0x8000));
+  pattern.push_back(0 | (0x8000));
+  return pattern;
+}
+
+static void checkEncoding()
+{
+  CHECK(WS2812_PWM_TOP == CTOPVAL, "period %d ticks", WS2812_PWM_TOP);
+  // WS2812B: T0H 0.4us, T1H 0.8us, each +-150ns, 1.25us per bit, at 16MHz.
+  CHECK((WS2812_PWM_T0H & 0x7FFF) * 1000 / 16 >= 250 && (WS2812_PWM_T0H & 0x7FFF) * 1000 / 16 <= 550,
+        "T0H %d ticks", WS2812_PWM_T0H & 0x7FFF);
+  CHECK((WS2812_PWM_T1H & 0x7FFF) * 1000 / 16 >= 650 && (WS2812_PWM_T1H & 0x7FFF) * 1000 / 16 <= 950,
+        "T1H %d ticks", WS2812_PWM_T1H & 0x7FFF);
+
+  srand(1);
+  int mismatches = 0;
+  for (int round = 0; round < 200; round++)
+  {
+    uint16_t numBytes = 3 * (1 + rand() % 100);
+    std::vector<uint8_t> pixels(numBytes);
+    for (uint16_t i = 0; i < numBytes; i++)
+    {
+      // Plenty of 0x00, 0xFF and single bits.
+      int kind = rand() % 4;
+      pixels[i] = kind == 0 ? 0 : kind == 1 ? 0xFF : kind == 2 ? (1 << (rand() % 8)) : rand();
+    }
+
+    std::vector<uint16_t> expected = referenceEncode(pixels.data(), numBytes);
+    std::vector<uint16_t> waveform(WaveformCache::getWaveformWords(numBytes) + 1, 0xBEEF);
+    WaveformCache::encode(pixels.data(), numBytes, waveform.data());
+    if (expected.size() != WaveformCache::getWaveformWords(numBytes) ||
+        memcmp(expected.data(), waveform.data(), expected.size() * 2) != 0 || waveform.back() != 0xBEEF)
+    {
+      mismatches++;
+    }
+  }
+  CHECK(mismatches == 0, "%d of 200 buffers encoded differently", mismatches);
+}
+
+// Shows loops of the pattern, a frame at a time, like the player does.
+static void showLoops(WaveformCache& cache, Adafruit_NeoPixel& strip, GimpLedPattern& pattern, int loops,
+                      int& wrong, int& uncached)
+{
+  std::vector<uint16_t> expected(WaveformCache::getWaveformWords(strip.numPixels() * 3));
+  for (int loop = 0; loop < loops; loop++)
+  {
+    for (int framePos = 0; framePos < pattern.getTotalFrames(); framePos++)
+    {
+      pattern.renderFrame(framePos);
+      const uint16_t * waveform = cache.lookup(&pattern, framePos);
+      if (waveform == NULL)
+      {
+        uncached++;
+        continue;
+      }
+      WaveformCache::encode(strip.getPixels(), strip.numPixels() * 3, expected.data());
+      if (memcmp(waveform, expected.data(), expected.size() * 2) != 0)
+      {
+        wrong++;
+      }
+    }
+  }
+}
+
+static void checkLoops()
+{
+  Adafruit_NeoPixel strip(ELEMENT_TOTAL_LEDS, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT red(strip, 0xff0000);
+  Pattern_ELEMENT blue(strip, 0x0000ff);
+  WaveformCache cache(strip);
+  int wrong = 0;
+  int uncached = 0;
+
+  // Every frame is encoded once, then only hits.
+  showLoops(cache, strip, red, 10, wrong, uncached);
+  printf("%u slots at %u LEDs, 10 loops of 8 frames: %u hits, %u misses\n", cache.getSlotCount(),
+         strip.numPixels(), cache.getHits(), cache.getMisses());
+  CHECK(cache.getMisses() == ELEMENT_TOTAL_FRAMES, "misses %u", cache.getMisses());
+  CHECK(cache.getHits() == 9 * ELEMENT_TOTAL_FRAMES, "hits %u", cache.getHits());
+
+  // Another pattern, a recolour and a brightness change all re-encode.
+  showLoops(cache, strip, blue, 2, wrong, uncached);
+  CHECK(cache.getMisses() == 2 * ELEMENT_TOTAL_FRAMES, "misses %u after a pattern switch", cache.getMisses());
+  blue.getColorLut()->setTint(0x00ff00);
+  showLoops(cache, strip, blue, 2, wrong, uncached);
+  CHECK(cache.getMisses() == 3 * ELEMENT_TOTAL_FRAMES, "misses %u after a recolour", cache.getMisses());
+  strip.setBrightness(100);
+  blue.invalidateFrame();
+  showLoops(cache, strip, blue, 2, wrong, uncached);
+  CHECK(cache.getMisses() == 4 * ELEMENT_TOTAL_FRAMES, "misses %u after a brightness change", cache.getMisses());
+  CHECK(wrong == 0, "%d stale waveforms", wrong);
+  CHECK(uncached == 0, "%d frames not cached", uncached);
+
+  // Doesn't fit: no slot is used and no frame is encoded.
+  Adafruit_NeoPixel longStrip(300, 7, NEO_GRB + NEO_KHZ800);
+  Pattern_ELEMENT longRed(longStrip, 0xff0000);
+  WaveformCache longCache(longStrip);
+  wrong = 0;
+  uncached = 0;
+  showLoops(longCache, longStrip, longRed, 3, wrong, uncached);
+  printf("%u slots at %u LEDs: %d of %d frames not cached\n", longCache.getSlotCount(), longStrip.numPixels(),
+         uncached, 3 * ELEMENT_TOTAL_FRAMES);
+  CHECK(uncached == 3 * ELEMENT_TOTAL_FRAMES, "%d frames not cached", uncached);
+  CHECK(longCache.getMisses() == 0, "encoded %u frames that can't be kept", longCache.getMisses());
+}
+
+int main()
+{
+  checkEncoding();
+  checkLoops();
+
+  return testResult();
+}
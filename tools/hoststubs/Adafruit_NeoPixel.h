@@ -0,0 +1,134 @@
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+// Same values as the library, only the colour order is used.
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel;
+
+// Called on every show(), after the strip was latched.
+typedef void (*host_show_hook_t) (Adafruit_NeoPixel& strip);
+
+/**
+ * Keeps the pixel buffer the way the library does (colour order and
+ * brightness scaling) and counts show() calls instead of sending them.
+ */
+class Adafruit_NeoPixel
+{
+  public:
+    Adafruit_NeoPixel(uint16_t numPixels, int16_t pin, uint16_t type): mNumPixels(numPixels), mPin(pin)
+    {
+      mRedOffset = (type >> 4) & 3;
+      mGreenOffset = (type >> 2) & 3;
+      mBlueOffset = type & 3;
+      mPixels = new uint8_t[numPixels * 3];
+      memset(mPixels, 0, numPixels * 3);
+    }
+
+    ~Adafruit_NeoPixel()
+    {
+      delete[] mPixels;
+    }
+
+    void begin() {}
+
+    void show()
+    {
+      mShowCount++;
+      if (mShowHook != NULL)
+      {
+        mShowHook(*this);
+      }
+    }
+
+    bool canShow()
+    {
+      return true;
+    }
+
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+    {
+      if (n >= mNumPixels)
+      {
+        return;
+      }
+      if (mBrightness != 0)
+      {
+        r = (r * mBrightness) >> 8;
+        g = (g * mBrightness) >> 8;
+        b = (b * mBrightness) >> 8;
+      }
+      uint8_t * p = mPixels + n * 3;
+      p[mRedOffset] = r;
+      p[mGreenOffset] = g;
+      p[mBlueOffset] = b;
+    }
+
+    void setPixelColor(uint16_t n, uint32_t c)
+    {
+      setPixelColor(n, (c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+    }
+
+    // Stored as brightness + 1 so 255 means no scaling, like the library.
+    void setBrightness(uint8_t brightness)
+    {
+      mBrightness = brightness + 1;
+    }
+
+    uint8_t getBrightness()
+    {
+      return mBrightness - 1;
+    }
+
+    void clear()
+    {
+      memset(mPixels, 0, mNumPixels * 3);
+    }
+
+    uint8_t * getPixels()
+    {
+      return mPixels;
+    }
+
+    uint16_t numPixels()
+    {
+      return mNumPixels;
+    }
+
+    int16_t getPin()
+    {
+      return mPin;
+    }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+    {
+      return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    uint32_t getShowCount()
+    {
+      return mShowCount;
+    }
+
+    void setShowHook(host_show_hook_t showHook)
+    {
+      mShowHook = showHook;
+    }
+
+  private:
+    uint16_t mNumPixels;
+    int16_t mPin;
+    uint8_t * mPixels;
+    uint8_t mBrightness = 0;
+    uint8_t mRedOffset;
+    uint8_t mGreenOffset;
+    uint8_t mBlueOffset;
+    uint32_t mShowCount = 0;
+    host_show_hook_t mShowHook = NULL;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+/****
+ * Just enough of the Arduino core to build the sketch and its headers on
+ * a PC, for the tests in test/ and the tools in tools/. Time is virtual:
+ * it only moves when the program calls hostAdvanceMicros() or delay().
+ ****/
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define A7 7
+#define AR_DEFAULT 0
+#define AR_INTERNAL_3_0 1
+
+inline uint64_t& hostMicrosNow()
+{
+  static uint64_t now = 0;
+  return now;
+}
+
+inline void hostAdvanceMicros(uint64_t us)
+{
+  hostMicrosNow() += us;
+}
+
+inline void hostSetMillis(uint32_t ms)
+{
+  hostMicrosNow() = (uint64_t)ms * 1000;
+}
+
+inline uint32_t millis()
+{
+  return (uint32_t)(hostMicrosNow() / 1000);
+}
+
+inline uint32_t micros()
+{
+  return (uint32_t)hostMicrosNow();
+}
+
+inline void delay(uint32_t ms)
+{
+  hostAdvanceMicros((uint64_t)ms * 1000);
+}
+
+inline void delayMicroseconds(uint32_t us)
+{
+  hostAdvanceMicros(us);
+}
+
+inline void yield() {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// FreeRTOS, which the nRF52 core includes from Arduino.h.
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline void analogWrite(uint8_t, int) {}
+inline void analogReference(uint8_t) {}
+inline void analogReadResolution(int) {}
+
+// A full battery on the 12-bit VBAT divider.
+inline int analogRead(uint8_t)
+{
+  return 4000;
+}
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t print(const char * text)
+    {
+      size_t n = 0;
+      while (*text != 0)
+      {
+        n += write(*text++);
+      }
+      return n;
+    }
+
+    size_t print(char c)
+    {
+      return write(c);
+    }
+
+    size_t print(long value)
+    {
+      char text[24];
+      snprintf(text, sizeof(text), "%ld", value);
+      return print(text);
+    }
+
+    size_t print(int value)
+    {
+      return print((long)value);
+    }
+
+    size_t print(unsigned long value)
+    {
+      char text[24];
+      snprintf(text, sizeof(text), "%lu", value);
+      return print(text);
+    }
+
+    size_t print(unsigned int value)
+    {
+      return print((unsigned long)value);
+    }
+
+    template <typename T> size_t println(T value)
+    {
+      return print(value) + println();
+    }
+
+    size_t println()
+    {
+      return write('\n');
+    }
+};
+
+// Serial goes to stdout, or nowhere after hostSerialQuiet().
+class HostSerial : public Print
+{
+  public:
+    bool quiet = false;
+
+    void begin(uint32_t) {}
+
+    operator bool()
+    {
+      return true;
+    }
+
+    size_t write(uint8_t c)
+    {
+      if (!quiet)
+      {
+        putchar(c);
+      }
+      return 1;
+    }
+};
+
+static HostSerial Serial;
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+#include <stdint.h>
+#include <string.h>
+
+// Flash and RAM share one address space on the host, as on the nRF52.
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef HOST_BLUEFRUIT_H
+#define HOST_BLUEFRUIT_H
+/****
+ * The parts of the Bluefruit nRF52 API the sketch uses. Nothing is sent:
+ * writes are fed in by calling the write callback directly and
+ * notifications are counted, the last one is kept.
+ ****/
+#include <Arduino.h>
+
+#define CHR_PROPS_READ 0x02
+#define CHR_PROPS_WRITE 0x08
+#define CHR_PROPS_NOTIFY 0x10
+#define SECMODE_NO_ACCESS 0x00
+#define SECMODE_OPEN 0x11
+#define BANDWIDTH_MAX 4
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE 0x06
+
+struct ble_uuid_t
+{
+  uint16_t uuid;
+  uint8_t type;
+};
+
+class BLEUuid
+{
+  public:
+    ble_uuid_t _uuid;
+
+    BLEUuid()
+    {
+      _uuid.uuid = 0;
+      _uuid.type = 0;
+    }
+
+    BLEUuid(uint16_t uuid16)
+    {
+      _uuid.uuid = uuid16;
+      _uuid.type = 1;
+    }
+
+    bool operator==(const BLEUuid& other) const
+    {
+      return _uuid.uuid == other._uuid.uuid && _uuid.type == other._uuid.type;
+    }
+};
+
+class BLEService
+{
+  public:
+    BLEUuid uuid;
+
+    BLEService() {}
+    BLEService(uint16_t uuid16): uuid(uuid16) {}
+
+    void begin() {}
+};
+
+class BLECharacteristic
+{
+  public:
+    typedef void (*write_cb_t) (uint16_t conn_hdl, BLECharacteristic * chr, uint8_t * data, uint16_t len);
+
+    BLEUuid uuid;
+    uint32_t notifyCount = 0;
+    uint8_t lastValue[32];
+    uint16_t lastLen = 0;
+
+    BLECharacteristic() {}
+    BLECharacteristic(uint16_t uuid16): uuid(uuid16) {}
+
+    void setProperties(uint8_t) {}
+    void setPermission(uint8_t, uint8_t) {}
+    void setFixedLen(uint16_t) {}
+    void setMaxLen(uint16_t) {}
+    void setUserDescriptor(const char *) {}
+    void begin() {}
+
+    void setWriteCallback(write_cb_t writeCallback)
+    {
+      mWrite_cb = writeCallback;
+    }
+
+    write_cb_t getWriteCallback()
+    {
+      return mWrite_cb;
+    }
+
+    bool notifyEnabled()
+    {
+      return true;
+    }
+
+    bool notify(const void * data, uint16_t len)
+    {
+      notifyCount++;
+      return write(data, len);
+    }
+
+    bool write(const void * data, uint16_t len)
+    {
+      lastLen = len < sizeof(lastValue) ? len : sizeof(lastValue);
+      memcpy(lastValue, data, lastLen);
+      return true;
+    }
+
+  private:
+    write_cb_t mWrite_cb = NULL;
+};
+
+class BLEDis
+{
+  public:
+    void setManufacturer(const char *) {}
+    void setModel(const char *) {}
+    void begin() {}
+};
+
+class BLEBas
+{
+  public:
+    void begin() {}
+    void write(uint8_t) {}
+    void notify(uint8_t) {}
+};
+
+class BLEConnection
+{
+  public:
+    void getPeerName(char * name, uint16_t size)
+    {
+      snprintf(name, size, "host");
+    }
+};
+
+class BLEAdvertising
+{
+  public:
+    void addFlags(uint8_t) {}
+    void addTxPower() {}
+    void addService(BLEService&) {}
+    void addName() {}
+    void restartOnDisconnect(bool) {}
+    void setInterval(uint16_t, uint16_t) {}
+    void setFastTimeout(uint16_t) {}
+    void start(uint16_t) {}
+};
+
+class BLECentral
+{
+  public:
+    void setConnectCallback(void (*)(uint16_t)) {}
+    void setDisconnectCallback(void (*)(uint16_t, uint8_t)) {}
+};
+
+class AdafruitBluefruit
+{
+  public:
+    BLEAdvertising Advertising;
+    BLECentral Central;
+
+    void configPrphBandwidth(uint8_t) {}
+    void begin() {}
+    void autoConnLed(bool) {}
+    void setName(const char *) {}
+
+    void getAddr(uint8_t * address)
+    {
+      memset(address, 0, 6);
+    }
+
+    BLEConnection * Connection(uint16_t)
+    {
+      return &mConnection;
+    }
+
+  private:
+    BLEConnection mConnection;
+};
+
+static AdafruitBluefruit Bluefruit;
+
+#endif
@@ -0,0 +1,239 @@
+/****
+ * propreplay - replays a trace dumped by the prop (CMD_TRACE, dump op)
+ * through the sketch on a PC, on the stubbed Arduino, NeoPixel and
+ * Bluefruit headers in tools/hoststubs.
+ *
+ * The sketch is put in the state the recording started from, then every
+ * recorded BLE write is handed to characteristic_write_callback() at its
+ * recorded time while loop() runs on a virtual clock, 1 ms per call. The
+ * run is fully deterministic: the same trace and sketch always give the
+ * same output, so it can be kept as a regression input.
+ *
+ * The output is the trace the replay produced, as a "TRACE REPLAY"
+ * section in the dump format. Compare it with the recording using
+ * tools/proptrace, or with the output of another build using diff. With
+ * -p every shown frame's strip bytes are printed too ("PX <ms> <hex>").
+ *
+ * Build (from the sketch folder):
+ *   g++ -std=gnu++11 -O2 -Wno-write-strings -I tools/hoststubs -I . -o tools/propreplay/propreplay tools/propreplay/propreplay.cpp
+ * Usage: propreplay [-p] [-e extraMs] <capture.log>
+ *
+ * Replays the first dump in the capture, up to its last record. With -e
+ * the sketch keeps running for extraMs after that.
+ ****/
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "KinsectLedCode.ino"
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c)
+    {
+      putchar(c);
+      return 1;
+    }
+};
+
+static StdoutPrint out;
+
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool parseRecord(const char * hex, TraceRecord& record)
+{
+  uint8_t bytes[TRACE_HEADER_LEN + TRACE_MAX_PAYLOAD];
+  size_t count = 0;
+  while (hex[0] != 0 && hex[1] != 0 && count < sizeof(bytes))
+  {
+    int high = hexValue(hex[0]);
+    int low = hexValue(hex[1]);
+    if (high < 0 || low < 0)
+    {
+      break;
+    }
+    bytes[count++] = (high << 4) | low;
+    hex += 2;
+  }
+
+  if (count < TRACE_HEADER_LEN || count != TRACE_HEADER_LEN + (size_t)bytes[1])
+  {
+    return false;
+  }
+
+  record.type = bytes[0];
+  record.len = bytes[1];
+  record.time = bytes[2] | (bytes[3] << 8) | (bytes[4] << 16) | ((uint32_t)bytes[5] << 24);
+  memcpy(record.data, bytes + TRACE_HEADER_LEN, record.len);
+  return true;
+}
+
+// Records of the first dump, or of the whole file when it has no header.
+static bool loadTrace(const char * path, std::vector<TraceRecord>& records)
+{
+  FILE * in = fopen(path, "r");
+  if (in == NULL)
+  {
+    fprintf(stderr, "%s: can't open\n", path);
+    return false;
+  }
+
+  char line[1024];
+  int lineNumber = 0;
+  bool inDump = false;
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    lineNumber++;
+    if (strncmp(line, "TRACE BEGIN", 11) == 0)
+    {
+      if (!records.empty())
+      {
+        break;
+      }
+      inDump = true;
+    }
+    else if (strncmp(line, "TRACE END", 9) == 0 || strncmp(line, "TRACE REPLAY", 12) == 0)
+    {
+      if (inDump || !records.empty())
+      {
+        break;
+      }
+    }
+    else if (strncmp(line, "TR ", 3) == 0)
+    {
+      TraceRecord record;
+      if (!parseRecord(line + 3, record))
+      {
+        fprintf(stderr, "%s:%d: bad record\n", path, lineNumber);
+        continue;
+      }
+      records.push_back(record);
+    }
+  }
+
+  fclose(in);
+  return true;
+}
+
+static void printPixels(Adafruit_NeoPixel& shown)
+{
+  static const char digits[] = "0123456789abcdef";
+  printf("PX %u ", millis());
+  const uint8_t * pixels = shown.getPixels();
+  for (uint16_t i = 0; i < shown.numPixels() * 3; i++)
+  {
+    putchar(digits[pixels[i] >> 4]);
+    putchar(digits[pixels[i] & 0x0F]);
+  }
+  putchar('\n');
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: propreplay [-p] [-e extraMs] <capture.log>\n");
+}
+
+int main(int argc, char ** argv)
+{
+  bool pixels = false;
+  uint32_t extraMs = 0;
+  const char * path = NULL;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "-p")
+    {
+      pixels = true;
+    }
+    else if (arg == "-e" && i + 1 < argc)
+    {
+      extraMs = atoi(argv[++i]);
+    }
+    else if (arg[0] == '-' || path != NULL)
+    {
+      usage();
+      return 2;
+    }
+    else
+    {
+      path = argv[i];
+    }
+  }
+
+  std::vector<TraceRecord> records;
+  if (path == NULL)
+  {
+    usage();
+    return 2;
+  }
+  if (!loadTrace(path, records))
+  {
+    return 2;
+  }
+  if (records.empty())
+  {
+    fprintf(stderr, "%s: no trace records\n", path);
+    return 2;
+  }
+
+  // The sketch's own debug output would get in the way of the trace.
+  Serial.quiet = true;
+  hostSetMillis(records[0].time);
+  setup();
+
+  out.println("TRACE REPLAY");
+  trace.setEcho(&out);
+  if (pixels)
+  {
+    strip.setShowHook(printPixels);
+  }
+
+  size_t next = 0;
+  if (records[0].type == TRACE_START)
+  {
+    // Put the prop back in the state the recording started from.
+    sequencer.cancel();
+    activatePattern(getPatternById(records[0].data[0]));
+    next = 1;
+  }
+
+  uint32_t end = records.back().time + extraMs;
+  while ((int32_t)(millis() - end) <= 0)
+  {
+    for (; next < records.size() && (int32_t)(millis() - records[next].time) >= 0; next++)
+    {
+      const TraceRecord& record = records[next];
+      if (record.type == TRACE_BLE_WRITE && record.len > 4)
+      {
+        uint8_t data[TRACE_MAX_PAYLOAD];
+        memcpy(data, record.data + 4, record.len - 4);
+        characteristic_write_callback(record.data[0] | (record.data[1] << 8),
+                                      &activePropService.getPropCharacteristic(), data, record.len - 4);
+      }
+    }
+
+    loop();
+    hostAdvanceMicros(1000);
+  }
+
+  trace.setEcho(NULL);
+  out.println("TRACE END");
+  return 0;
+}
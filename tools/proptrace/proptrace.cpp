@@ -0,0 +1,380 @@
+/****
+ * proptrace - decodes and compares the command/render traces written by
+ * PropTrace.h ("TR <hex>" lines in a serial capture).
+ *
+ * A capture is split into sections at "TRACE BEGIN" (a dump) and
+ * "TRACE REPLAY" (the output of tools/propreplay). With one section the timeline
+ * is printed. With more, every following section is compared against
+ * the first: BLE writes and shown frames are matched in order, times are
+ * taken relative to the first BLE write of each section.
+ *
+ * Build: g++ -std=c++11 -O2 -o proptrace proptrace.cpp
+ * Usage: proptrace [-t toleranceMs] <capture.log>...
+ *
+ * Exits with 1 when a compared section has missing or extra events, or a
+ * frame is shown more than toleranceMs (default 20) away from the reference.
+ ****/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Must match PropTrace.h
+#define TRACE_HEADER_LEN 6
+#define TRACE_START 1
+#define TRACE_BLE_WRITE 2
+#define TRACE_ACTIVATE 3
+#define TRACE_SHOW 4
+
+// How far ahead the replay is searched for a frame missing at its position.
+#define MATCH_WINDOW 32
+
+// Differences printed per section before only counting them.
+#define MAX_REPORTED 10
+
+struct Record
+{
+  uint8_t type;
+  uint32_t time;
+  std::vector<uint8_t> data;
+};
+
+struct Section
+{
+  std::string name;
+  std::vector<Record> records;
+};
+
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool parseRecord(const char * hex, Record& record)
+{
+  std::vector<uint8_t> bytes;
+  while (hex[0] != 0 && hex[1] != 0)
+  {
+    int high = hexValue(hex[0]);
+    int low = hexValue(hex[1]);
+    if (high < 0 || low < 0)
+    {
+      break;
+    }
+    bytes.push_back((high << 4) | low);
+    hex += 2;
+  }
+
+  if (bytes.size() < TRACE_HEADER_LEN || bytes.size() != TRACE_HEADER_LEN + (size_t)bytes[1])
+  {
+    return false;
+  }
+
+  record.type = bytes[0];
+  record.time = bytes[2] | (bytes[3] << 8) | (bytes[4] << 16) | ((uint32_t)bytes[5] << 24);
+  record.data.assign(bytes.begin() + TRACE_HEADER_LEN, bytes.end());
+  return true;
+}
+
+static bool loadCapture(const char * path, std::vector<Section>& sections)
+{
+  FILE * in = fopen(path, "r");
+  if (in == NULL)
+  {
+    fprintf(stderr, "%s: can't open\n", path);
+    return false;
+  }
+
+  char line[1024];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    lineNumber++;
+    if (strncmp(line, "TRACE BEGIN", 11) == 0 || strncmp(line, "TRACE REPLAY", 12) == 0)
+    {
+      Section section;
+      section.name = std::string(path) + ":" + std::to_string(lineNumber) + (line[6] == 'B' ? " dump" : " replay");
+      sections.push_back(section);
+    }
+    else if (strncmp(line, "TR ", 3) == 0)
+    {
+      if (sections.empty())
+      {
+        // Capture started in the middle of a dump.
+        Section section;
+        section.name = std::string(path) + ":" + std::to_string(lineNumber);
+        sections.push_back(section);
+      }
+
+      Record record;
+      if (!parseRecord(line + 3, record))
+      {
+        fprintf(stderr, "%s:%d: bad record\n", path, lineNumber);
+        continue;
+      }
+      sections.back().records.push_back(record);
+    }
+  }
+
+  fclose(in);
+  return true;
+}
+
+static int getFrame(const Record& record)
+{
+  int frame = record.data[1] | (record.data[2] << 8);
+  return frame == 0xFFFF ? -1 : frame;
+}
+
+static void describe(const Record& record, char * text, size_t size)
+{
+  if (record.type == TRACE_BLE_WRITE && record.data.size() >= 4)
+  {
+    int len = snprintf(text, size, "write    conn %d chr 0x%04x ", record.data[0] | (record.data[1] << 8),
+                       record.data[2] | (record.data[3] << 8));
+    for (size_t i = 4; i < record.data.size() && len + 4 < (int)size; i++)
+    {
+      len += snprintf(text + len, size - len, " %02x", record.data[i]);
+    }
+  }
+  else if (record.type == TRACE_SHOW && record.data.size() >= 3)
+  {
+    snprintf(text, size, "show     pattern %d frame %d", record.data[0], getFrame(record));
+  }
+  else if ((record.type == TRACE_ACTIVATE || record.type == TRACE_START) && record.data.size() >= 1)
+  {
+    snprintf(text, size, "%s pattern %d", record.type == TRACE_START ? "start   " : "activate", record.data[0]);
+  }
+  else
+  {
+    snprintf(text, size, "unknown  type %d", record.type);
+  }
+}
+
+static void printSection(const Section& section)
+{
+  printf("%s, %zu records\n", section.name.c_str(), section.records.size());
+  if (section.records.empty())
+  {
+    return;
+  }
+
+  uint32_t base = section.records[0].time;
+  uint32_t lastShow = 0;
+  bool hasShow = false;
+  for (size_t i = 0; i < section.records.size(); i++)
+  {
+    const Record& record = section.records[i];
+    char text[512];
+    describe(record, text, sizeof(text));
+    printf("%8u ms  %s", record.time - base, text);
+    if (record.type == TRACE_SHOW)
+    {
+      if (hasShow)
+      {
+        printf("  (+%u ms)", record.time - lastShow);
+      }
+      lastShow = record.time;
+      hasShow = true;
+    }
+    printf("\n");
+  }
+}
+
+// Events of one kind, with times relative to the section's first BLE write.
+static std::vector<const Record *> select(const Section& section, uint8_t type, uint32_t& base)
+{
+  base = section.records.empty() ? 0 : section.records[0].time;
+  for (size_t i = 0; i < section.records.size(); i++)
+  {
+    if (section.records[i].type == TRACE_BLE_WRITE)
+    {
+      base = section.records[i].time;
+      break;
+    }
+  }
+
+  std::vector<const Record *> events;
+  for (size_t i = 0; i < section.records.size(); i++)
+  {
+    const Record& record = section.records[i];
+    if (record.type == type && (int32_t)(record.time - base) >= 0)
+    {
+      events.push_back(&record);
+    }
+  }
+  return events;
+}
+
+static bool sameEvent(const Record * a, const Record * b)
+{
+  if (a->type == TRACE_BLE_WRITE)
+  {
+    // Connection handles change between sessions.
+    return a->data.size() == b->data.size() && std::equal(a->data.begin() + 2, a->data.end(), b->data.begin() + 2);
+  }
+  return a->data == b->data;
+}
+
+struct CompareResult
+{
+  int matched = 0;
+  int missing = 0;
+  int extra = 0;
+  int late = 0;
+  int32_t maxDelta = 0;
+  int64_t totalDelta = 0;
+};
+
+static CompareResult compareEvents(const char * kind, const std::vector<const Record *>& reference, uint32_t referenceBase,
+                                   const std::vector<const Record *>& events, uint32_t eventBase, int toleranceMs)
+{
+  CompareResult result;
+  int reported = 0;
+  size_t next = 0;
+
+  for (size_t i = 0; i < reference.size(); i++)
+  {
+    size_t found = next;
+    while (found < events.size() && found < next + MATCH_WINDOW && !sameEvent(reference[i], events[found]))
+    {
+      found++;
+    }
+
+    char text[512];
+    int32_t referenceTime = reference[i]->time - referenceBase;
+    if (found >= events.size() || found >= next + MATCH_WINDOW)
+    {
+      result.missing++;
+      if (reported++ < MAX_REPORTED)
+      {
+        describe(*reference[i], text, sizeof(text));
+        printf("  missing %8d ms  %s\n", referenceTime, text);
+      }
+      continue;
+    }
+
+    for (size_t j = next; j < found; j++)
+    {
+      result.extra++;
+      if (reported++ < MAX_REPORTED)
+      {
+        describe(*events[j], text, sizeof(text));
+        printf("  extra   %8d ms  %s\n", (int32_t)(events[j]->time - eventBase), text);
+      }
+    }
+    next = found + 1;
+
+    int32_t delta = (int32_t)(events[found]->time - eventBase) - referenceTime;
+    int32_t magnitude = delta < 0 ? -delta : delta;
+    result.matched++;
+    result.totalDelta += magnitude;
+    if (magnitude > result.maxDelta)
+    {
+      result.maxDelta = magnitude;
+    }
+    if (magnitude > toleranceMs)
+    {
+      result.late++;
+      if (reported++ < MAX_REPORTED)
+      {
+        describe(*reference[i], text, sizeof(text));
+        printf("  %+6d ms %8d ms  %s\n", delta, referenceTime, text);
+      }
+    }
+  }
+
+  for (size_t j = next; j < events.size(); j++)
+  {
+    result.extra++;
+  }
+
+  printf("  %-6s matched %d, missing %d, extra %d, mean |dt| %.1f ms, max |dt| %d ms, over tolerance %d\n", kind,
+         result.matched, result.missing, result.extra,
+         result.matched > 0 ? (double)result.totalDelta / result.matched : 0.0, result.maxDelta, result.late);
+  return result;
+}
+
+static bool compareSections(const Section& reference, const Section& section, int toleranceMs)
+{
+  printf("%s against %s\n", section.name.c_str(), reference.name.c_str());
+
+  uint32_t referenceBase;
+  uint32_t sectionBase;
+  std::vector<const Record *> referenceWrites = select(reference, TRACE_BLE_WRITE, referenceBase);
+  std::vector<const Record *> writes = select(section, TRACE_BLE_WRITE, sectionBase);
+  // Commands are replayed on the main loop, so their timing is not judged.
+  CompareResult writeResult = compareEvents("writes", referenceWrites, referenceBase, writes, sectionBase, INT32_MAX);
+
+  std::vector<const Record *> referenceShows = select(reference, TRACE_SHOW, referenceBase);
+  std::vector<const Record *> shows = select(section, TRACE_SHOW, sectionBase);
+  CompareResult showResult = compareEvents("frames", referenceShows, referenceBase, shows, sectionBase, toleranceMs);
+
+  return writeResult.missing == 0 && writeResult.extra == 0 &&
+         showResult.missing == 0 && showResult.extra == 0 && showResult.late == 0;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: proptrace [-t toleranceMs] <capture.log>...\n");
+}
+
+int main(int argc, char ** argv)
+{
+  int toleranceMs = 20;
+  std::vector<Section> sections;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "-t" && i + 1 < argc)
+    {
+      toleranceMs = atoi(argv[++i]);
+    }
+    else if (!arg.empty() && arg[0] == '-')
+    {
+      usage();
+      return 2;
+    }
+    else if (!loadCapture(argv[i], sections))
+    {
+      return 2;
+    }
+  }
+
+  if (sections.empty())
+  {
+    usage();
+    return 2;
+  }
+
+  if (sections.size() == 1)
+  {
+    printSection(sections[0]);
+    return 0;
+  }
+
+  bool same = true;
+  for (size_t i = 1; i < sections.size(); i++)
+  {
+    same = compareSections(sections[0], sections[i], toleranceMs) && same;
+  }
+  return same ? 0 : 1;
+}
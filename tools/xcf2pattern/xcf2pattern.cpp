@@ -0,0 +1,1197 @@
+/****
+ * xcf2pattern - generates Pattern_*.h files straight from GIMP .xcf images,
+ * without GIMP or the Gimp LEDs plug-in.
+ *
+ * Every visible layer is one frame (top layer first), every pixel of the
+ * LED row one LED. Layer opacity and alpha are applied against black, the
+ * same way the plug-in flattens a frame.
+ *
+ * With -k the pattern is written as a DeltaLedPattern: a keyframe every
+ * <interval> frames and delta frames holding only the changed LED spans.
+ *
+ * With -l the pattern is written recolourable: every LED becomes an index
+ * into a table of brightness levels of the brightest colour in the image,
+ * and the colour is picked at runtime through a ColorLut. Implies -k 8
+ * unless -k is given. -n sets the pattern name instead of the file name.
+ *
+ * Build: g++ -std=c++11 -O2 -o xcf2pattern xcf2pattern.cpp
+ * Usage: xcf2pattern [-o outDir] [-d delayMs] [-r row] [-k interval] [-l] [-n name] [-f] <file.xcf | dir>...
+ *
+ * Outputs are only regenerated when the source hash (or the options)
+ * changed, hashes are kept in outDir/.xcf2pattern.cache. -f forces it.
+ ****/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// Bump when the generated output changes so cached outputs are rebuilt.
+#define XCF2PATTERN_VERSION 1
+
+#define CACHE_FILE_NAME ".xcf2pattern.cache"
+
+#define XCF_TILE_SIZE 64
+
+// GIMP_MAX_IMAGE_SIZE, larger dimensions can only come from a corrupt file.
+#define XCF_MAX_SIZE 524288
+
+#define PROP_END 0
+#define PROP_OPACITY 6
+#define PROP_VISIBLE 8
+#define PROP_OFFSETS 15
+#define PROP_COMPRESSION 17
+
+#define COMPRESS_NONE 0
+#define COMPRESS_RLE 1
+
+// Must match DeltaLedPattern.h
+#define DELTA_SPAN_RUN 0x80
+#define DELTA_SPAN_MAX_LEDS 128
+#define DELTA_MAX_SPANS 255
+
+// Unchanged LEDs between two changed spans are resent when that is
+// cheaper than starting a new span (3 bytes of span header).
+#define DELTA_MERGE_GAP 1
+
+// Shortest run of one colour worth its own span.
+#define DELTA_MIN_RUN 3
+
+// Keyframe interval used by -l when -k isn't given.
+#define LUMA_KEYFRAME_INTERVAL 8
+
+// Largest channel difference from a pure tint before -l warns that
+// the image has more than one hue.
+#define LUMA_HUE_TOLERANCE 2
+
+struct Options
+{
+  std::string outDir = ".";
+  int delayMs = 200;
+  int row = 0;
+  int keyframeInterval = 0;
+  bool luma = false;
+  std::string name;
+  bool force = false;
+};
+
+struct Frame
+{
+  std::string name;
+  std::vector<uint32_t> leds;
+};
+
+class XcfReader
+{
+  public:
+    XcfReader(const std::vector<uint8_t>& data): mData(data) {}
+
+    bool read(int row, std::vector<Frame>& frames, std::string& error)
+    {
+      if (mData.size() < 14 || memcmp(&mData[0], "gimp xcf ", 9) != 0)
+      {
+        error = "not an xcf file";
+        return false;
+      }
+
+      mVersion = 0;
+      if (memcmp(&mData[9], "file", 4) != 0)
+      {
+        mVersion = atoi((const char *)&mData[10]);
+      }
+
+      mPos = 14;
+      mWidth = readUint32();
+      mHeight = readUint32();
+      if (!isValidSize(mWidth, mHeight))
+      {
+        error = "invalid image size";
+        return false;
+      }
+      uint32_t baseType = readUint32();
+      if (baseType != 0)
+      {
+        error = "only RGB images are supported";
+        return false;
+      }
+      if (mVersion >= 4)
+      {
+        uint32_t precision = readUint32();
+        // 8-bit integer: 0 in version 4, from version 5 on 100 (linear),
+        // 150 (gamma) or 175 (perceptual).
+        bool eightBit = mVersion == 4 ? precision == 0 : (precision == 100 || precision == 150 || precision == 175);
+        if (!eightBit)
+        {
+          error = "only 8-bit images are supported";
+          return false;
+        }
+      }
+
+      mCompression = COMPRESS_NONE;
+      uint32_t type;
+      do
+      {
+        type = readUint32();
+        uint32_t len = readUint32();
+        if (type == PROP_COMPRESSION)
+        {
+          size_t next = mPos + len;
+          mCompression = readUint8();
+          mPos = next;
+        }
+        else
+        {
+          mPos += len;
+        }
+      } while (type != PROP_END && !mFailed);
+
+      if (mCompression > COMPRESS_RLE)
+      {
+        error = "zlib compressed xcf files are not supported, save with RLE";
+        return false;
+      }
+
+      std::vector<uint64_t> layers;
+      for (uint64_t ptr = readPointer(); ptr != 0 && !mFailed; ptr = readPointer())
+      {
+        layers.push_back(ptr);
+      }
+
+      if (row < 0 || (uint32_t)row >= mHeight)
+      {
+        error = "LED row is outside the image";
+        return false;
+      }
+
+      for (size_t i = 0; i < layers.size() && !mFailed; i++)
+      {
+        Frame frame;
+        if (readLayer(layers[i], row, frame))
+        {
+          frames.push_back(frame);
+        }
+      }
+
+      if (mFailed)
+      {
+        error = "truncated or corrupt xcf file";
+        return false;
+      }
+      return true;
+    }
+
+  private:
+    const std::vector<uint8_t>& mData;
+    size_t mPos = 0;
+    bool mFailed = false;
+    int mVersion = 0;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    uint8_t mCompression = COMPRESS_NONE;
+
+    static bool isValidSize(uint32_t width, uint32_t height)
+    {
+      return width > 0 && height > 0 && width <= XCF_MAX_SIZE && height <= XCF_MAX_SIZE;
+    }
+
+    uint32_t readUint32()
+    {
+      if (mPos + 4 > mData.size())
+      {
+        mFailed = true;
+        mPos = mData.size();
+        return 0;
+      }
+      uint32_t value = ((uint32_t)mData[mPos] << 24) | ((uint32_t)mData[mPos + 1] << 16) |
+                       ((uint32_t)mData[mPos + 2] << 8) | mData[mPos + 3];
+      mPos += 4;
+      return value;
+    }
+
+    uint8_t readUint8()
+    {
+      if (mPos + 1 > mData.size())
+      {
+        mFailed = true;
+        mPos = mData.size();
+        return 0;
+      }
+      return mData[mPos++];
+    }
+
+    uint64_t readPointer()
+    {
+      // Pointers are 64-bit from version 11 on.
+      if (mVersion >= 11)
+      {
+        uint64_t high = readUint32();
+        return (high << 32) | readUint32();
+      }
+      return readUint32();
+    }
+
+    bool readLayer(uint64_t ptr, int row, Frame& frame)
+    {
+      mPos = ptr;
+      uint32_t width = readUint32();
+      uint32_t height = readUint32();
+      uint32_t type = readUint32();
+      uint32_t nameLen = readUint32();
+      if (mPos + nameLen > mData.size())
+      {
+        mFailed = true;
+        return false;
+      }
+      frame.name.assign((const char *)&mData[mPos], nameLen > 0 ? nameLen - 1 : 0);
+      mPos += nameLen;
+
+      uint32_t opacity = 255;
+      bool visible = true;
+      int32_t offsetX = 0;
+      int32_t offsetY = 0;
+      uint32_t propType;
+      do
+      {
+        propType = readUint32();
+        uint32_t len = readUint32();
+        size_t next = mPos + len;
+        if (propType == PROP_OPACITY)
+        {
+          opacity = readUint32();
+        }
+        else if (propType == PROP_VISIBLE)
+        {
+          visible = readUint32() != 0;
+        }
+        else if (propType == PROP_OFFSETS)
+        {
+          offsetX = (int32_t)readUint32();
+          offsetY = (int32_t)readUint32();
+        }
+        mPos = next;
+      } while (propType != PROP_END && !mFailed);
+
+      uint64_t hierarchy = readPointer();
+      if (!visible || mFailed)
+      {
+        return false;
+      }
+      if (!isValidSize(width, height))
+      {
+        mFailed = true;
+        return false;
+      }
+
+      frame.leds.assign(mWidth, 0);
+      int32_t layerRow = row - offsetY;
+      if (layerRow < 0 || layerRow >= (int32_t)height)
+      {
+        // The LED row misses this layer.
+        return true;
+      }
+
+      // RGB or RGBA, grayscale and indexed layers can't be in an RGB image.
+      uint32_t bpp = type == 1 ? 4 : 3;
+      std::vector<uint8_t> pixels;
+      if (!readHierarchy(hierarchy, width, height, bpp, layerRow, pixels))
+      {
+        return false;
+      }
+
+      for (uint32_t x = 0; x < mWidth; x++)
+      {
+        int32_t layerX = (int32_t)x - offsetX;
+        if (layerX < 0 || layerX >= (int32_t)width)
+        {
+          continue;
+        }
+
+        const uint8_t * pixel = &pixels[(size_t)layerX * bpp];
+        uint32_t alpha = bpp == 4 ? pixel[3] : 255;
+        uint32_t scale = alpha * opacity;
+        uint32_t red = pixel[0] * scale / (255 * 255);
+        uint32_t green = pixel[1] * scale / (255 * 255);
+        uint32_t blue = pixel[2] * scale / (255 * 255);
+        frame.leds[x] = (red << 16) | (green << 8) | blue;
+      }
+      return true;
+    }
+
+    // Decodes only the tiles holding 'row' and returns that row's pixels.
+    bool readHierarchy(uint64_t ptr, uint32_t width, uint32_t height, uint32_t bpp, uint32_t row,
+                       std::vector<uint8_t>& pixels)
+    {
+      mPos = ptr;
+      readUint32(); // width
+      readUint32(); // height
+      if (readUint32() != bpp)
+      {
+        mFailed = true;
+        return false;
+      }
+
+      // Only the first level holds the full size image.
+      mPos = readPointer();
+      readUint32();
+      readUint32();
+
+      std::vector<uint64_t> tiles;
+      for (uint64_t tile = readPointer(); tile != 0 && !mFailed; tile = readPointer())
+      {
+        tiles.push_back(tile);
+      }
+
+      uint32_t tilesX = (width + XCF_TILE_SIZE - 1) / XCF_TILE_SIZE;
+      uint32_t tilesY = (height + XCF_TILE_SIZE - 1) / XCF_TILE_SIZE;
+      if (mFailed || tiles.size() < (size_t)tilesX * tilesY)
+      {
+        mFailed = true;
+        return false;
+      }
+
+      pixels.assign((size_t)width * bpp, 0);
+      uint32_t ty = row / XCF_TILE_SIZE;
+      uint32_t y = row % XCF_TILE_SIZE;
+      for (uint32_t tx = 0; tx < tilesX; tx++)
+      {
+        uint32_t tileWidth = std::min<uint32_t>(XCF_TILE_SIZE, width - tx * XCF_TILE_SIZE);
+        uint32_t tileHeight = std::min<uint32_t>(XCF_TILE_SIZE, height - ty * XCF_TILE_SIZE);
+        std::vector<uint8_t> tile;
+        if (!readTile(tiles[(size_t)ty * tilesX + tx], tileWidth * tileHeight, bpp, tile))
+        {
+          return false;
+        }
+        memcpy(&pixels[(size_t)tx * XCF_TILE_SIZE * bpp], &tile[(size_t)y * tileWidth * bpp], tileWidth * bpp);
+      }
+      return true;
+    }
+
+    // Tiles are stored as interleaved pixels when uncompressed, and as one
+    // RLE stream per channel otherwise.
+    bool readTile(uint64_t ptr, uint32_t pixelCount, uint32_t bpp, std::vector<uint8_t>& tile)
+    {
+      size_t pos = ptr;
+      tile.assign((size_t)pixelCount * bpp, 0);
+
+      if (mCompression == COMPRESS_NONE)
+      {
+        if (pos + tile.size() > mData.size())
+        {
+          mFailed = true;
+          return false;
+        }
+        memcpy(&tile[0], &mData[pos], tile.size());
+        return true;
+      }
+
+      for (uint32_t channel = 0; channel < bpp; channel++)
+      {
+        uint32_t count = 0;
+        while (count < pixelCount)
+        {
+          if (pos >= mData.size())
+          {
+            mFailed = true;
+            return false;
+          }
+
+          uint32_t op = mData[pos++];
+          bool literal;
+          uint32_t length;
+          if (op <= 126)
+          {
+            literal = false;
+            length = op + 1;
+          }
+          else if (op >= 129)
+          {
+            literal = true;
+            length = 256 - op;
+          }
+          else
+          {
+            if (pos + 2 > mData.size())
+            {
+              mFailed = true;
+              return false;
+            }
+            literal = op == 128;
+            length = (mData[pos] << 8) | mData[pos + 1];
+            pos += 2;
+          }
+
+          if (count + length > pixelCount || pos + (literal ? length : 1) > mData.size())
+          {
+            mFailed = true;
+            return false;
+          }
+
+          for (uint32_t i = 0; i < length; i++)
+          {
+            tile[(size_t)(count + i) * bpp + channel] = literal ? mData[pos + i] : mData[pos];
+          }
+          pos += literal ? length : 1;
+          count += length;
+        }
+      }
+      return true;
+    }
+};
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data)
+{
+  FILE * file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  uint8_t buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    data.insert(data.end(), buffer, buffer + read);
+  }
+  fclose(file);
+  return true;
+}
+
+static uint64_t fnv1a(const std::vector<uint8_t>& data, uint64_t hash = 14695981039346656037ULL)
+{
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    hash ^= data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// "Element_Fire.xcf" -> "ELEMENT_FIRE", "Background copy #5" -> "BACKGROUND_COPY_5"
+static std::string toIdentifier(const std::string& text)
+{
+  std::string id;
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    char c = text[i];
+    if (isalnum((unsigned char)c))
+    {
+      id += toupper((unsigned char)c);
+    }
+    else if (!id.empty() && id[id.size() - 1] != '_')
+    {
+      id += '_';
+    }
+  }
+  while (!id.empty() && id[id.size() - 1] == '_')
+  {
+    id.erase(id.size() - 1);
+  }
+  if (id.empty() || isdigit((unsigned char)id[0]))
+  {
+    id = "FRAME_" + id;
+  }
+  return id;
+}
+
+static std::string baseName(const std::string& path)
+{
+  size_t slash = path.find_last_of('/');
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  size_t dot = name.find_last_of('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static void writeFrameTable(FILE * out, const std::string& name, const std::vector<uint32_t>& leds)
+{
+  fprintf(out, "\tconst uint32_t %s[] PROGMEM = { \n\t", name.c_str());
+  for (size_t i = 0; i < leds.size(); i++)
+  {
+    fprintf(out, "0x%06x", leds[i]);
+    if (i + 1 < leds.size())
+    {
+      fprintf(out, (i + 1) % 10 == 0 ? ", \n\t" : ", ");
+    }
+  }
+  fprintf(out, "\n\n\t\t};\n\n");
+}
+
+static bool writePattern(const std::string& path, const std::string& source, const std::string& pattern,
+                         const std::vector<Frame>& frames, const Options& options)
+{
+  FILE * out = fopen(path.c_str(), "w");
+  if (out == NULL)
+  {
+    return false;
+  }
+
+  const char * p = pattern.c_str();
+  size_t totalLeds = frames.empty() ? 0 : frames[0].leds.size();
+
+  fprintf(out, "\n/****\n * Pattern file generated from %s by tools/xcf2pattern.\n", source.c_str());
+  fprintf(out, " * Identical frames are stored once and shared in the frame table.\n ****/ \n \n");
+  fprintf(out, "#ifndef %s_H\n#define %s_H\n", p, p);
+  fprintf(out, "#include <avr/pgmspace.h>\n#include <Adafruit_NeoPixel.h>\n#include \"GimpLedPattern.h\"\n\n");
+  fprintf(out, "#define %s_DELAY %d\n\n#define %s_TOTAL_LEDS %u\n\n", p, options.delayMs, p, (unsigned)totalLeds);
+  fprintf(out, "namespace NS_%s {\n\n", p);
+
+  // Frame tables, with repeated frames pointing at the first copy.
+  std::vector<std::string> tableNames;
+  std::map<std::string, int> usedNames;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    std::string table;
+    for (size_t j = 0; j < i; j++)
+    {
+      if (frames[j].leds == frames[i].leds)
+      {
+        table = tableNames[j];
+        break;
+      }
+    }
+
+    if (table.empty())
+    {
+      table = toIdentifier(frames[i].name);
+      int uses = usedNames[table]++;
+      if (uses > 0)
+      {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%d", uses);
+        table += suffix;
+      }
+      writeFrameTable(out, table, frames[i].leds);
+    }
+    tableNames.push_back(table);
+  }
+
+  fprintf(out, "\tconst uint32_t *const %s[] PROGMEM = { \n", p);
+  for (size_t i = 0; i < tableNames.size(); i++)
+  {
+    fprintf(out, "\t%s,\n", tableNames[i].c_str());
+  }
+  fprintf(out, "\t};\n\n");
+
+  fprintf(out, "\tconst uint32_t %s_SIZES[] PROGMEM = { \n", p);
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    fprintf(out, "\t%u,\n", (unsigned)frames[i].leds.size());
+  }
+  fprintf(out, "\t};\n\n}\n\nusing namespace NS_%s;\n\n\t\t\n", p);
+
+  fprintf(out,
+    "class Pattern_%s : public GimpLedPattern \n"
+    "{\n"
+    "\n"
+    "  public:\n"
+    "    Pattern_%s(Adafruit_NeoPixel& strip): GimpLedPattern(strip){}\n"
+    "\n"
+    "    ~Pattern_%s(){}\n"
+    "\n"
+    "    void playPattern() \n"
+    "    {\n"
+    "      int totalFrames = sizeof(%s) / sizeof(uint32_t*);\n"
+    "      for (int framePos = 0; framePos < totalFrames; framePos ++)\n"
+    "      {\n"
+    "        int frameTotalLeds = pgm_read_dword(&(%s_SIZES[framePos]));\n"
+    "\t\tint ledOffset = 0;\n"
+    "        for (int ledPos = 0; ledPos < frameTotalLeds; ledPos++)\n"
+    "        {\n"
+    "          if(mInterrupt)\n"
+    "          {\n"
+    "            // If we are interrupted stop the pattern. \"Clean\" LED pattern.\n"
+    "            mStrip.clear();\n"
+    "            mStrip.show();\n"
+    "            mInterrupt = false;\n"
+    "            return;\n"
+    "          }\n"
+    "          uint32_t ledColor = pgm_read_dword(&(%s[framePos][ledPos]));\n"
+    "          int blue = ledColor & 0x00FF;\n"
+    "          int green = (ledColor >> 8) & 0x00FF;\n"
+    "          int red = (ledColor >>  16) & 0x00FF;\n"
+    "          mStrip.setPixelColor(ledPos + ledOffset, red, green, blue);\n"
+    "\n"
+    "        }\n"
+    "        mStrip.show();\n"
+    "        delay(%s_DELAY);\n"
+    "      }\n"
+    "    }\n"
+    "\n"
+    "    \n"
+    "    void stopPattern() \n"
+    "    {\n"
+    "      mInterrupt = true;\n"
+    "    }\n"
+    "\n"
+    "    int getTotalFrames()\n"
+    "    {\n"
+    "      return sizeof(%s) / sizeof(uint32_t*);\n"
+    "    }\n"
+    "\n"
+    "    int getFrameDelay()\n"
+    "    {\n"
+    "      return %s_DELAY;\n"
+    "    }\n"
+    "\n"
+    "    void renderFrame(int framePos)\n"
+    "    {\n"
+    "      int frameTotalLeds = pgm_read_dword(&(%s_SIZES[framePos]));\n"
+    "      int ledOffset = 0;\n"
+    "      for (int ledPos = 0; ledPos < frameTotalLeds; ledPos++)\n"
+    "      {\n"
+    "        uint32_t ledColor = pgm_read_dword(&(%s[framePos][ledPos]));\n"
+    "        int blue = ledColor & 0x00FF;\n"
+    "        int green = (ledColor >> 8) & 0x00FF;\n"
+    "        int red = (ledColor >>  16) & 0x00FF;\n"
+    "        mStrip.setPixelColor(ledPos + ledOffset, red, green, blue);\n"
+    "      }\n"
+    "    }\n"
+    "};\n"
+    "\t\t\n"
+    "#endif //%s_H\n",
+    p, p, p, p, p, p, p, p, p, p, p, p);
+
+  fclose(out);
+  return true;
+}
+
+// Indexed streams store one level index per colour instead of [r g b].
+static void appendSpan(std::vector<uint8_t>& stream, size_t start, size_t count, bool run, const uint32_t * colors,
+                       bool indexed)
+{
+  stream.push_back(start & 0xFF);
+  stream.push_back((start >> 8) & 0xFF);
+  stream.push_back((run ? DELTA_SPAN_RUN : 0) | (count - 1));
+  for (size_t i = 0; i < (run ? 1 : count); i++)
+  {
+    if (indexed)
+    {
+      stream.push_back(colors[i] & 0xFF);
+      continue;
+    }
+    stream.push_back((colors[i] >> 16) & 0xFF);
+    stream.push_back((colors[i] >> 8) & 0xFF);
+    stream.push_back(colors[i] & 0xFF);
+  }
+}
+
+// Splits leds[begin, end) into run and literal spans, returns the span count.
+static int encodeRange(const std::vector<uint32_t>& leds, size_t begin, size_t end, std::vector<uint8_t>& stream,
+                       bool indexed)
+{
+  int spans = 0;
+  size_t pos = begin;
+  while (pos < end)
+  {
+    size_t run = 1;
+    while (pos + run < end && run < DELTA_SPAN_MAX_LEDS && leds[pos + run] == leds[pos])
+    {
+      run++;
+    }
+
+    if (run >= DELTA_MIN_RUN)
+    {
+      appendSpan(stream, pos, run, true, &leds[pos], indexed);
+      pos += run;
+      spans++;
+      continue;
+    }
+
+    // Literal until the next run worth splitting out.
+    size_t literal = run;
+    while (pos + literal < end && literal < DELTA_SPAN_MAX_LEDS)
+    {
+      size_t next = pos + literal;
+      size_t nextRun = 1;
+      while (next + nextRun < end && nextRun < DELTA_MIN_RUN && leds[next + nextRun] == leds[next])
+      {
+        nextRun++;
+      }
+      if (nextRun >= DELTA_MIN_RUN)
+      {
+        break;
+      }
+      literal++;
+    }
+    appendSpan(stream, pos, literal, false, &leds[pos], indexed);
+    pos += literal;
+    spans++;
+  }
+  return spans;
+}
+
+// Appends one frame. Keyframes (previous == NULL) cover every LED, delta
+// frames only the spans that differ from the previous frame.
+static void encodeFrame(const std::vector<uint32_t> * previous, const std::vector<uint32_t>& leds, std::vector<uint8_t>& stream,
+                        bool indexed)
+{
+  size_t countPos = stream.size();
+  stream.push_back(0);
+
+  int spans = 0;
+  if (previous == NULL)
+  {
+    spans = encodeRange(leds, 0, leds.size(), stream, indexed);
+  }
+  else
+  {
+    size_t pos = 0;
+    while (pos < leds.size())
+    {
+      if (leds[pos] == (*previous)[pos])
+      {
+        pos++;
+        continue;
+      }
+
+      size_t end = pos + 1;
+      size_t gap = 0;
+      for (size_t i = end; i < leds.size() && gap <= DELTA_MERGE_GAP; i++)
+      {
+        if (leds[i] != (*previous)[i])
+        {
+          end = i + 1;
+          gap = 0;
+        }
+        else
+        {
+          gap++;
+        }
+      }
+
+      spans += encodeRange(leds, pos, end, stream, indexed);
+      pos = end;
+    }
+  }
+
+  if (spans > DELTA_MAX_SPANS)
+  {
+    // Too fragmented, send the whole frame as literals instead.
+    stream.resize(countPos + 1);
+    spans = 0;
+    for (size_t pos = 0; pos < leds.size(); pos += DELTA_SPAN_MAX_LEDS)
+    {
+      size_t count = std::min<size_t>(DELTA_SPAN_MAX_LEDS, leds.size() - pos);
+      appendSpan(stream, pos, count, false, &leds[pos], indexed);
+      spans++;
+    }
+  }
+  stream[countPos] = spans;
+}
+
+// Turns the frames into indices into a table of brightness levels of the
+// brightest colour. Returns how many LEDs are off from a pure tint.
+static int toLevels(const std::vector<Frame>& frames, std::vector<Frame>& indexed, std::vector<uint8_t>& levels,
+                    uint32_t& baseColor)
+{
+  baseColor = 0;
+  int baseMax = 0;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    for (size_t led = 0; led < frames[i].leds.size(); led++)
+    {
+      uint32_t color = frames[i].leds[led];
+      int high = std::max(std::max((color >> 16) & 0xFF, (color >> 8) & 0xFF), color & 0xFF);
+      if (high > baseMax)
+      {
+        baseMax = high;
+        baseColor = color;
+      }
+    }
+  }
+
+  // Level of every LED, then the distinct levels in ascending order.
+  indexed = frames;
+  int offHue = 0;
+  std::vector<bool> used(256, false);
+  for (size_t i = 0; i < indexed.size(); i++)
+  {
+    for (size_t led = 0; led < indexed[i].leds.size(); led++)
+    {
+      uint32_t color = indexed[i].leds[led];
+      int high = std::max(std::max((color >> 16) & 0xFF, (color >> 8) & 0xFF), color & 0xFF);
+      int level = baseMax > 0 ? (high * 255 + baseMax / 2) / baseMax : 0;
+      for (int shift = 0; shift < 24; shift += 8)
+      {
+        int expected = (((baseColor >> shift) & 0xFF) * level) / 255;
+        if (abs(expected - (int)((color >> shift) & 0xFF)) > LUMA_HUE_TOLERANCE)
+        {
+          offHue++;
+          break;
+        }
+      }
+      indexed[i].leds[led] = level;
+      used[level] = true;
+    }
+  }
+
+  std::vector<uint8_t> indexOf(256, 0);
+  levels.clear();
+  for (int level = 0; level < 256; level++)
+  {
+    if (used[level])
+    {
+      indexOf[level] = levels.size();
+      levels.push_back(level);
+    }
+  }
+  for (size_t i = 0; i < indexed.size(); i++)
+  {
+    for (size_t led = 0; led < indexed[i].leds.size(); led++)
+    {
+      indexed[i].leds[led] = indexOf[indexed[i].leds[led]];
+    }
+  }
+  return offHue;
+}
+
+static bool writeDeltaPattern(const std::string& path, const std::string& source, const std::string& pattern,
+                              const std::vector<Frame>& sourceFrames, const Options& options)
+{
+  std::vector<Frame> levelFrames;
+  std::vector<uint8_t> levels;
+  uint32_t baseColor = 0;
+  if (options.luma)
+  {
+    int offHue = toLevels(sourceFrames, levelFrames, levels, baseColor);
+    if (offHue > 0)
+    {
+      fprintf(stderr, "%s: warning: %d LEDs are not a shade of #%06x, recolouring changes them\n",
+              source.c_str(), offHue, baseColor);
+    }
+  }
+  const std::vector<Frame>& frames = options.luma ? levelFrames : sourceFrames;
+
+  std::vector<uint8_t> stream;
+  std::vector<uint32_t> keyframes;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if (i % options.keyframeInterval == 0)
+    {
+      keyframes.push_back(stream.size());
+      encodeFrame(NULL, frames[i].leds, stream, options.luma);
+    }
+    else
+    {
+      encodeFrame(&frames[i - 1].leds, frames[i].leds, stream, options.luma);
+    }
+  }
+
+  FILE * out = fopen(path.c_str(), "w");
+  if (out == NULL)
+  {
+    return false;
+  }
+
+  const char * p = pattern.c_str();
+  size_t totalLeds = frames[0].leds.size();
+  size_t rawBytes = frames.size() * totalLeds * sizeof(uint32_t);
+
+  fprintf(out, "\n/****\n * Pattern file generated from %s by tools/xcf2pattern.\n", source.c_str());
+  fprintf(out, " * Delta encoded, see DeltaLedPattern.h for the stream layout.\n");
+  if (options.luma)
+  {
+    fprintf(out, " * Recolourable, colours are indices into %s_LEVELS, see ColorLut.h.\n", p);
+  }
+  fprintf(out, " ****/ \n \n");
+  fprintf(out, "#ifndef %s_H\n#define %s_H\n", p, p);
+  fprintf(out, "#include <avr/pgmspace.h>\n#include <Adafruit_NeoPixel.h>\n#include \"DeltaLedPattern.h\"\n\n");
+  fprintf(out, "#define %s_DELAY %d\n\n#define %s_TOTAL_LEDS %u\n\n", p, options.delayMs, p, (unsigned)totalLeds);
+  fprintf(out, "#define %s_TOTAL_FRAMES %u\n\n#define %s_KEYFRAME_INTERVAL %d\n\n",
+          p, (unsigned)frames.size(), p, options.keyframeInterval);
+  if (options.luma)
+  {
+    fprintf(out, "#define %s_COLOR 0x%06x\n\n#define %s_LEVEL_COUNT %u\n\n", p, baseColor, p, (unsigned)levels.size());
+  }
+  fprintf(out, "namespace NS_%s {\n\n", p);
+
+  if (options.luma)
+  {
+    fprintf(out, "\tconst uint8_t %s_LEVELS[] PROGMEM = { ", p);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+      fprintf(out, i + 1 < levels.size() ? "%u, " : "%u };\n\n", levels[i]);
+    }
+  }
+
+  fprintf(out, "\t// %u frames, %u keyframes, %u bytes (%u bytes as frame tables).\n",
+          (unsigned)frames.size(), (unsigned)keyframes.size(), (unsigned)stream.size(), (unsigned)rawBytes);
+  fprintf(out, "\tconst uint8_t %s_STREAM[] PROGMEM = { \n\t", p);
+  for (size_t i = 0; i < stream.size(); i++)
+  {
+    fprintf(out, "0x%02x", stream[i]);
+    if (i + 1 < stream.size())
+    {
+      fprintf(out, (i + 1) % 16 == 0 ? ", \n\t" : ", ");
+    }
+  }
+  fprintf(out, "\n\n\t\t};\n\n");
+
+  fprintf(out, "\tconst uint32_t %s_KEYFRAMES[] PROGMEM = { \n", p);
+  for (size_t i = 0; i < keyframes.size(); i++)
+  {
+    fprintf(out, "\t%u,\n", keyframes[i]);
+  }
+  fprintf(out, "\t};\n\n}\n\nusing namespace NS_%s;\n\n\t\t\n", p);
+
+  if (options.luma)
+  {
+    fprintf(out,
+      "class Pattern_%s : public DeltaLedPattern \n"
+      "{\n"
+      "\n"
+      "  public:\n"
+      "    Pattern_%s(Adafruit_NeoPixel& strip, uint32_t color = %s_COLOR)\n"
+      "      : DeltaLedPattern(strip, %s_STREAM, %s_KEYFRAMES, %s_TOTAL_FRAMES, %s_KEYFRAME_INTERVAL, %s_DELAY, &mLevelColors),\n"
+      "        mLevelColors(%s_LEVELS, %s_LEVEL_COUNT)\n"
+      "    {\n"
+      "      mLevelColors.setTint(color);\n"
+      "    }\n"
+      "\n"
+      "    ~Pattern_%s(){}\n"
+      "\n"
+      "  protected:\n"
+      "    ColorLut mLevelColors;\n"
+      "};\n"
+      "\t\t\n"
+      "#endif //%s_H\n",
+      p, p, p, p, p, p, p, p, p, p, p, p);
+    fclose(out);
+    return true;
+  }
+
+  fprintf(out,
+    "class Pattern_%s : public DeltaLedPattern \n"
+    "{\n"
+    "\n"
+    "  public:\n"
+    "    Pattern_%s(Adafruit_NeoPixel& strip)\n"
+    "      : DeltaLedPattern(strip, %s_STREAM, %s_KEYFRAMES, %s_TOTAL_FRAMES, %s_KEYFRAME_INTERVAL, %s_DELAY){}\n"
+    "\n"
+    "    ~Pattern_%s(){}\n"
+    "};\n"
+    "\t\t\n"
+    "#endif //%s_H\n",
+    p, p, p, p, p, p, p, p, p);
+
+  fclose(out);
+  return true;
+}
+
+static std::map<std::string, std::string> loadCache(const std::string& path)
+{
+  std::map<std::string, std::string> cache;
+  FILE * file = fopen(path.c_str(), "r");
+  if (file == NULL)
+  {
+    return cache;
+  }
+
+  char key[64];
+  char name[512];
+  while (fscanf(file, "%63s %511s", key, name) == 2)
+  {
+    cache[name] = key;
+  }
+  fclose(file);
+  return cache;
+}
+
+static void saveCache(const std::string& path, const std::map<std::string, std::string>& cache)
+{
+  FILE * file = fopen(path.c_str(), "w");
+  if (file == NULL)
+  {
+    return;
+  }
+
+  for (std::map<std::string, std::string>::const_iterator it = cache.begin(); it != cache.end(); ++it)
+  {
+    fprintf(file, "%s %s\n", it->second.c_str(), it->first.c_str());
+  }
+  fclose(file);
+}
+
+static bool fileExists(const std::string& path)
+{
+  struct stat info;
+  return stat(path.c_str(), &info) == 0;
+}
+
+static void collectInputs(const std::string& path, std::vector<std::string>& inputs)
+{
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+  {
+    inputs.push_back(path);
+    return;
+  }
+
+  DIR * dir = opendir(path.c_str());
+  if (dir == NULL)
+  {
+    return;
+  }
+
+  std::vector<std::string> found;
+  struct dirent * entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".xcf") == 0)
+    {
+      found.push_back(path + "/" + name);
+    }
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end());
+  inputs.insert(inputs.end(), found.begin(), found.end());
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: xcf2pattern [-o outDir] [-d delayMs] [-r row] [-k interval] [-l] [-n name] [-f] <file.xcf | dir>...\n");
+}
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if ((arg == "-o" || arg == "-d" || arg == "-r" || arg == "-k" || arg == "-n") && i + 1 < argc)
+    {
+      const char * value = argv[++i];
+      if (arg == "-o")
+      {
+        options.outDir = value;
+      }
+      else if (arg == "-n")
+      {
+        options.name = toIdentifier(value);
+      }
+      else if (arg == "-d")
+      {
+        options.delayMs = atoi(value);
+      }
+      else if (arg == "-k")
+      {
+        options.keyframeInterval = atoi(value);
+      }
+      else
+      {
+        options.row = atoi(value);
+      }
+    }
+    else if (arg == "-f")
+    {
+      options.force = true;
+    }
+    else if (arg == "-l")
+    {
+      options.luma = true;
+    }
+    else if (!arg.empty() && arg[0] == '-')
+    {
+      usage();
+      return 2;
+    }
+    else
+    {
+      collectInputs(arg, inputs);
+    }
+  }
+
+  if (inputs.empty() || options.keyframeInterval < 0 || (!options.name.empty() && inputs.size() > 1))
+  {
+    usage();
+    return 2;
+  }
+  if (options.luma && options.keyframeInterval == 0)
+  {
+    options.keyframeInterval = LUMA_KEYFRAME_INTERVAL;
+  }
+
+  std::string cachePath = options.outDir + "/" + CACHE_FILE_NAME;
+  std::map<std::string, std::string> cache = loadCache(cachePath);
+
+  char optionKey[128];
+  snprintf(optionKey, sizeof(optionKey), "v%d d%d r%d k%d l%d n%s", XCF2PATTERN_VERSION, options.delayMs, options.row,
+           options.keyframeInterval, options.luma, options.name.c_str());
+  std::vector<uint8_t> optionBytes(optionKey, optionKey + strlen(optionKey));
+
+  int failures = 0;
+  int generated = 0;
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    std::vector<uint8_t> data;
+    if (!readFile(inputs[i], data))
+    {
+      fprintf(stderr, "%s: can't read file\n", inputs[i].c_str());
+      failures++;
+      continue;
+    }
+
+    std::string pattern = options.name.empty() ? toIdentifier(baseName(inputs[i])) : options.name;
+    std::string outName = "Pattern_" + pattern + ".h";
+    std::string outPath = options.outDir + "/" + outName;
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)fnv1a(data, fnv1a(optionBytes)));
+    if (!options.force && cache[outName] == key && fileExists(outPath))
+    {
+      continue;
+    }
+
+    std::vector<Frame> frames;
+    std::string error;
+    XcfReader reader(data);
+    if (!reader.read(options.row, frames, error))
+    {
+      fprintf(stderr, "%s: %s\n", inputs[i].c_str(), error.c_str());
+      failures++;
+      continue;
+    }
+    if (frames.empty())
+    {
+      fprintf(stderr, "%s: no visible layers\n", inputs[i].c_str());
+      failures++;
+      continue;
+    }
+
+    std::string source = inputs[i];
+    size_t slash = source.find_last_of('/');
+    size_t parent = slash == std::string::npos || slash == 0 ? std::string::npos : source.find_last_of('/', slash - 1);
+    if (parent != std::string::npos)
+    {
+      source = source.substr(parent + 1);
+    }
+
+    bool written = options.keyframeInterval > 0 ? writeDeltaPattern(outPath, source, pattern, frames, options)
+                                                : writePattern(outPath, source, pattern, frames, options);
+    if (!written)
+    {
+      fprintf(stderr, "%s: can't write\n", outPath.c_str());
+      failures++;
+      continue;
+    }
+
+    cache[outName] = key;
+    generated++;
+    printf("%s -> %s (%u frames)\n", inputs[i].c_str(), outPath.c_str(), (unsigned)frames.size());
+  }
+
+  saveCache(cachePath, cache);
+  printf("%d generated, %d up to date, %d failed\n", generated, (int)inputs.size() - generated - failures, failures);
+  return failures == 0 ? 0 : 1;
+}